@@ -0,0 +1,115 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// a conventional coroutine whose frame is allocated by the global operator new, resumed directly by its owner
+class heap_task {
+   public:
+    struct promise_type {
+        [[nodiscard]] heap_task get_return_object() noexcept {
+            return heap_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        [[nodiscard]] std::suspend_never initial_suspend() const noexcept { return {}; }
+        [[nodiscard]] std::suspend_always final_suspend() const noexcept { return {}; }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+   private:
+    std::coroutine_handle<promise_type> handle_;
+
+   public:
+    [[nodiscard]] bool done() const noexcept { return handle_.done(); }
+    void resume() const { handle_.resume(); }
+
+    heap_task& operator=(const heap_task& other) = delete;
+    heap_task(const heap_task& other) = delete;
+
+    explicit heap_task(std::coroutine_handle<promise_type> handle) noexcept : handle_{handle} {}
+    ~heap_task() noexcept { handle_.destroy(); }
+};
+
+// a fixed set of workers taking std::function tasks from a queue guarded by a mutex
+class thread_pool {
+   private:
+    std::mutex mutex_{};
+    std::condition_variable available_{};
+    std::deque<std::function<void()>> tasks_{};
+    bool stopping_{false};
+    std::vector<std::jthread> workers_{};
+
+    void work_() {
+        for (;;) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                available_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) { return; }
+
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            task();
+        }
+    }
+
+   public:
+    void submit(std::function<void()> task) {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+
+        available_.notify_one();
+    }
+
+    thread_pool& operator=(const thread_pool& other) = delete;
+    thread_pool(const thread_pool& other) = delete;
+
+    explicit thread_pool(const std::size_t threads) {
+        for (std::size_t index = 0; index < threads; ++index) { workers_.emplace_back([this] { work_(); }); }
+    }
+
+    ~thread_pool() {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+
+        available_.notify_all();
+    }
+};
+
+}  // namespace bench
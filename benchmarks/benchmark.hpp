@@ -0,0 +1,97 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string_view>
+
+namespace bench {
+
+// counts calls to the global operator new, replaced in main.cpp
+inline std::atomic_uint64_t allocations{0};
+
+struct result {
+    double nanoseconds_per_op;
+    double allocations_per_op;
+};
+
+[[nodiscard]] inline std::int64_t now() noexcept {
+    const auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+}
+
+// f(ops) performs ops operations, returning how many it performed. The fastest of a few repetitions is kept
+template <typename F>
+[[nodiscard]] result measure(const std::uint64_t ops, F&& f) {
+    constexpr int repetitions = 5;
+    result best{std::numeric_limits<double>::max(), 0.0};
+
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+        const std::uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+        const std::int64_t start = now();
+        const std::uint64_t performed = f(ops);
+        const std::int64_t elapsed = now() - start;
+        const std::uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+
+        const double nanoseconds_per_op = static_cast<double>(elapsed) / static_cast<double>(performed);
+        if (nanoseconds_per_op < best.nanoseconds_per_op) {
+            best = result{nanoseconds_per_op, static_cast<double>(allocated) / static_cast<double>(performed)};
+        }
+    }
+
+    return best;
+}
+
+inline void report(const std::string_view name, const result& measured) {
+    std::printf("%-56.*s %12.1f %12.3f\n", static_cast<int>(name.size()), name.data(), measured.nanoseconds_per_op,
+                measured.allocations_per_op);
+    std::fflush(stdout);
+}
+
+inline void report_header(const std::string_view title) {
+    std::printf("\n%-56.*s %12s %12s\n", static_cast<int>(title.size()), title.data(), "ns/op", "allocs/op");
+}
+
+// a latency, measured by the benchmark itself rather than by elapsed time
+struct latency {
+    std::int64_t total{0};
+    std::uint64_t count{0};
+
+    void record(const std::int64_t nanoseconds) noexcept {
+        total += nanoseconds;
+        ++count;
+    }
+
+    [[nodiscard]] result as_result() const noexcept {
+        return result{static_cast<double>(total) / static_cast<double>(std::max<std::uint64_t>(count, 1)), 0.0};
+    }
+};
+
+// busy waits, so that a waiting executor or worker has parked by the time it is woken
+inline void spin_for(const std::chrono::nanoseconds duration) noexcept {
+    const std::int64_t until = now() + duration.count();
+    while (now() < until) {}
+}
+
+}  // namespace bench
@@ -0,0 +1,350 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/event.hpp>
+#include <nano/execution.hpp>
+#include <nano/executor.hpp>
+#include <nano/huge_pages.hpp>
+#include <nano/mutex.hpp>
+#include <nano/yield.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "baselines.hpp"
+#include "benchmark.hpp"
+
+// every allocation made by the process is counted, so that benchmarks can report allocations per operation
+void* operator new(const std::size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) { return ptr; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+using buffer_type = nano::fixed_size_buffer<512u>;
+using chain_buffer_type = nano::fixed_size_buffer<4096u>;
+
+template <typename T>
+struct holder {
+    T value;
+
+    template <typename F>
+    explicit holder(F&& f) : value{f()} {}
+};
+
+nano::continuation<int> complete(nano::coroutine_context) { co_return 0; }
+
+nano::continuation<int> yield_n(nano::coroutine_context, const std::uint64_t count) {
+    for (std::uint64_t index = 0; index < count; ++index) { co_await nano::yield(); }
+    co_return 0;
+}
+
+nano::continuation<int> yield_until(nano::coroutine_context, const bool& stop) {
+    while (!stop) { co_await nano::yield(); }
+    co_return 0;
+}
+
+nano::continuation<int> await_event(nano::coroutine_context, nano::event<int>& event) {
+    co_await event;
+    co_return 0;
+}
+
+nano::continuation<int> receive_events(nano::coroutine_context, std::atomic<nano::event<std::int64_t>*>& slot,
+                                       const std::uint64_t count, bench::latency& latency) {
+    for (std::uint64_t index = 0; index < count; ++index) {
+        nano::event<std::int64_t> event{};
+        slot.store(&event, std::memory_order_release);
+
+        const std::int64_t sent = co_await event;
+        latency.record(bench::now() - sent);
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int, nano::execution::lazy> descend(nano::coroutine_context context, const std::size_t depth) {
+    if (depth == 0) {
+        co_await nano::yield();
+        co_return 0;
+    }
+
+    co_return co_await descend(context, depth - 1) + 1;
+}
+
+nano::continuation<int> call_chains(nano::coroutine_context context, const std::size_t depth,
+                                    const std::uint64_t count) {
+    for (std::uint64_t index = 0; index < count; ++index) { co_await descend(context, depth); }
+    co_return 0;
+}
+
+nano::continuation<int> contend(nano::coroutine_context context, nano::mutex& mutex, const std::uint64_t count) {
+    for (std::uint64_t index = 0; index < count; ++index) {
+        const auto guard = co_await nano::lock(context, mutex);
+        co_await nano::yield();
+    }
+
+    co_return 0;
+}
+
+bench::heap_task heap_complete() { co_return; }
+
+bench::heap_task heap_yield_n(const std::uint64_t count) {
+    for (std::uint64_t index = 0; index < count; ++index) { co_await std::suspend_always{}; }
+}
+
+void spawn() {
+    bench::report_header("spawn and complete an eager coroutine");
+
+    bench::report("nano::continuation", bench::measure(1'000'000, [](const std::uint64_t ops) {
+                      nano::executor<buffer_type, 1u> executor{};
+                      for (std::uint64_t op = 0; op < ops; ++op) {
+                          [[maybe_unused]] auto continuation = complete(executor.find_available_context());
+                      }
+
+                      return ops;
+                  }));
+
+    bench::report("heap-allocated coroutine", bench::measure(1'000'000, [](const std::uint64_t ops) {
+                      for (std::uint64_t op = 0; op < ops; ++op) { [[maybe_unused]] auto task = heap_complete(); }
+                      return ops;
+                  }));
+
+    bench::report("thread pool task (4 workers)", bench::measure(200'000, [](const std::uint64_t ops) {
+                      std::atomic_uint64_t completed{0};
+
+                      {
+                          bench::thread_pool pool{4u};
+                          for (std::uint64_t op = 0; op < ops; ++op) {
+                              pool.submit([&completed] { completed.fetch_add(1, std::memory_order_relaxed); });
+                          }
+                      }
+
+                      return completed.load();
+                  }));
+}
+
+template <typename S>
+bench::result yield_round_trip() {
+    return bench::measure(1'000'000, [](const std::uint64_t ops) {
+        nano::executor<buffer_type, 1u, S> executor{};
+        [[maybe_unused]] auto continuation = yield_n(executor.find_available_context(), ops);
+        executor.wait();
+        return ops;
+    });
+}
+
+void yield() {
+    bench::report_header("yield round trip through the executor");
+
+    bench::report("nano::yield (scheduling::poll)", yield_round_trip<nano::scheduling::poll>());
+    bench::report("nano::yield (scheduling::queued)", yield_round_trip<nano::scheduling::queued>());
+
+    bench::report("heap-allocated coroutine, resumed directly", bench::measure(1'000'000, [](const std::uint64_t ops) {
+                      auto task = heap_yield_n(ops);
+                      while (!task.done()) { task.resume(); }
+                      return ops;
+                  }));
+}
+
+template <std::size_t Depth, typename S>
+bench::result call_chain() {
+    return bench::measure(200'000, [](const std::uint64_t ops) {
+        nano::executor<chain_buffer_type, 1u, S> executor{};
+        [[maybe_unused]] auto continuation = call_chains(executor.find_available_context(), Depth, ops);
+        executor.wait();
+        return ops;
+    });
+}
+
+void chain() {
+    bench::report_header("await a chain of lazy coroutines, the innermost yielding once");
+
+    bench::report("depth 1 (scheduling::poll)", call_chain<1, nano::scheduling::poll>());
+    bench::report("depth 8 (scheduling::poll)", call_chain<8, nano::scheduling::poll>());
+    bench::report("depth 8 (scheduling::queued)", call_chain<8, nano::scheduling::queued>());
+}
+
+// ready of the N contexts loop on nano::yield while the rest await an event which is only sent once measured
+template <std::size_t N, typename S, bool HugePages>
+bench::result step_cost(const std::size_t ready) {
+    using executor_type = nano::executor<buffer_type, N, S>;
+    using continuation_type = nano::continuation<int>;
+
+    auto executor = [] {
+        if constexpr (HugePages) {
+            return nano::make_huge_page_backed<executor_type>();
+        } else {
+            return std::make_unique<executor_type>();
+        }
+    }();
+    bool stop = false;
+    auto releases = std::make_unique<nano::event<int>[]>(N);
+
+    std::vector<std::unique_ptr<holder<continuation_type>>> continuations{};
+    for (std::size_t index = 0; index < N; ++index) {
+        const auto context = executor->find_available_context();
+        continuations.push_back(std::make_unique<holder<continuation_type>>([&] {
+            return index < ready ? yield_until(context, stop) : await_event(context, releases[index]);
+        }));
+    }
+
+    const bench::result measured = bench::measure(2'000'000 / N, [&executor](const std::uint64_t ops) {
+        for (std::uint64_t op = 0; op < ops; ++op) { executor->step(); }
+        return ops;
+    });
+
+    stop = true;
+    for (std::size_t index = ready; index < N; ++index) { releases[index].send(0); }
+
+    executor->wait();
+    return measured;
+}
+
+template <std::size_t N, typename S, bool HugePages = false>
+void step_costs(const char* scheduling) {
+    for (const std::size_t percent : {0u, 10u, 100u}) {
+        const std::string name = "N=" + std::to_string(N) + ", " + std::to_string(percent) + "% ready (" +
+                                 std::string(scheduling) + ")";
+        bench::report(name, step_cost<N, S, HugePages>(N * percent / 100));
+    }
+}
+
+void step() {
+    bench::report_header("executor::step()");
+
+    step_costs<64, nano::scheduling::poll>("poll");
+    step_costs<1024, nano::scheduling::poll>("poll");
+    step_costs<16384, nano::scheduling::poll>("poll");
+    step_costs<16384, nano::scheduling::poll, true>("poll, huge pages");
+
+    step_costs<64, nano::scheduling::queued>("queued");
+    step_costs<1024, nano::scheduling::queued>("queued");
+    step_costs<16384, nano::scheduling::queued>("queued");
+}
+
+// latency from sending an event on another thread to the awaiting coroutine resuming. The sender waits delay first,
+// giving the executor time to park
+template <typename I>
+bench::result event_wake(const std::chrono::nanoseconds delay) {
+    constexpr std::uint64_t count = 20'000;
+
+    nano::executor<buffer_type, 1u, nano::scheduling::queued, I> executor{};
+    std::atomic<nano::event<std::int64_t>*> slot{nullptr};
+    bench::latency latency{};
+
+    std::jthread sender([&slot, delay] {
+        for (std::uint64_t index = 0; index < count; ++index) {
+            nano::event<std::int64_t>* event = nullptr;
+            while ((event = slot.exchange(nullptr, std::memory_order_acquire)) == nullptr) {}
+
+            bench::spin_for(delay);
+            event->send(bench::now());
+        }
+    });
+
+    [[maybe_unused]] auto continuation = receive_events(executor.find_available_context(), slot, count, latency);
+    executor.wait();
+    return latency.as_result();
+}
+
+bench::result thread_pool_wake(const std::chrono::nanoseconds delay) {
+    constexpr std::uint64_t count = 20'000;
+
+    bench::latency latency{};
+    bench::thread_pool pool{1u};
+
+    for (std::uint64_t index = 0; index < count; ++index) {
+        std::atomic_bool done{false};
+
+        bench::spin_for(delay);
+        pool.submit([&latency, &done, sent = bench::now()] {
+            latency.record(bench::now() - sent);
+            done.store(true, std::memory_order_release);
+        });
+
+        while (!done.load(std::memory_order_acquire)) {}
+    }
+
+    return latency.as_result();
+}
+
+void event() {
+    using namespace std::chrono_literals;
+    bench::report_header("cross-thread wake latency");
+
+    // a spinning executor competes with the sender for a single core
+    if (std::thread::hardware_concurrency() > 1) {
+        bench::report("nano::event, spinning executor (idle::spin)", event_wake<nano::idle::spin>(0ns));
+    }
+
+    bench::report("nano::event, parked executor (idle::adaptive<0, 0>)", event_wake<nano::idle::adaptive<0, 0>>(50us));
+    bench::report("thread pool task, parked worker", thread_pool_wake(50us));
+}
+
+template <std::size_t Contenders>
+bench::result mutex_contention() {
+    return bench::measure(400'000, [](const std::uint64_t ops) {
+        nano::executor<buffer_type, Contenders, nano::scheduling::queued> executor{};
+        nano::mutex mutex{};
+
+        std::vector<std::unique_ptr<holder<nano::continuation<int>>>> continuations{};
+        for (std::size_t index = 0; index < Contenders; ++index) {
+            const auto context = executor.find_available_context();
+            continuations.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return contend(context, mutex, ops / Contenders); }));
+        }
+
+        executor.wait();
+        return ops / Contenders * Contenders;
+    });
+}
+
+void mutex() {
+    bench::report_header("nano::mutex acquisition, held across a yield");
+
+    bench::report("1 coroutine", mutex_contention<1>());
+    bench::report("2 contending coroutines", mutex_contention<2>());
+    bench::report("64 contending coroutines", mutex_contention<64>());
+    bench::report("1024 contending coroutines", mutex_contention<1024>());
+}
+
+}  // namespace
+
+int main() {
+    spawn();
+    yield();
+    chain();
+    step();
+    event();
+    mutex();
+}
@@ -0,0 +1,279 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <nano/detail.hpp>
+#include <nano/executor.hpp>
+#include <nano/idle.hpp>
+#include <nano/overflow.hpp>
+#include <nano/scheduling.hpp>
+#include <nano/timer.hpp>
+#include <nano/tracing.hpp>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace nano {
+
+// count contexts, each with a stack of size bytes
+struct size_class {
+    std::size_t size;
+    std::size_t count;
+};
+
+// the peak stack usage of the coroutines spawned onto contexts handed out with it, from which an arena_executor picks
+// a size class. A frame which did not fit is recorded with the size it needed, so that the next context handed out
+// is large enough (given overflow::spill, or overflow::fail and a retry). Must outlive those coroutines
+class stack_profile {
+   private:
+    std::atomic_size_t peak_{0};
+
+    template <typename S, typename I, typename O>
+    friend class arena_executor;
+
+   public:
+    // zero until a coroutine spawned with the profile has pushed a frame
+    [[nodiscard]] std::size_t peak() const noexcept { return peak_.load(std::memory_order_relaxed); }
+
+    stack_profile& operator=(const stack_profile& other) = delete;
+    stack_profile(const stack_profile& other) = delete;
+
+    stack_profile() = default;
+};
+
+namespace detail {
+
+struct arena_context {
+    coroutine_stack stack_;
+    context_node node_;
+
+    arena_context& operator=(const arena_context& other) = delete;
+    arena_context(const arena_context& other) = delete;
+
+    arena_context(std::byte* data, const std::size_t n) noexcept : stack_(data, n), node_{stack_} {}
+};
+
+// the contexts carved out of an arena, as scanned by the scheduler
+struct arena_contexts {
+    std::atomic_bool* pending_{nullptr};
+    arena_context* contexts_{nullptr};
+    std::size_t count_{0};
+
+    [[nodiscard]] std::size_t size() const noexcept { return count_; }
+    [[nodiscard]] coroutine_stack& stack(const std::size_t index) noexcept { return contexts_[index].stack_; }
+    [[nodiscard]] const coroutine_stack& stack(const std::size_t index) const noexcept {
+        return contexts_[index].stack_;
+    }
+
+    [[nodiscard]] context_node& node(const std::size_t index) noexcept { return contexts_[index].node_; }
+    [[nodiscard]] std::atomic_bool& pending(const std::size_t index) noexcept { return pending_[index]; }
+    [[nodiscard]] const std::atomic_bool& pending(const std::size_t index) const noexcept { return pending_[index]; }
+};
+
+}  // namespace detail
+
+// As executor, with contexts of several size classes carved out of a single arena allocated at construction, so that
+// a few coroutines needing large stacks don't dictate the size of every context. Each context is handed out from the
+// smallest class fitting the stack size requested, or the peak recorded by a stack_profile
+template <typename S = scheduling::poll, typename I = idle::adaptive<>, typename O = overflow::terminate>
+class arena_executor {
+   private:
+    static_assert(!scheduling::is_prioritized_v<S>);
+
+    static constexpr std::size_t stack_align = 64;
+
+    struct arena_deleter_ {
+        void operator()(std::byte* arena) const noexcept { ::operator delete[](arena, std::align_val_t{stack_align}); }
+    };
+
+    std::vector<size_class> classes_;
+    std::unique_ptr<detail::context_pool[]> pools_;
+    std::unique_ptr<std::byte[], arena_deleter_> arena_;
+    detail::arena_contexts contexts_{};
+    detail::scheduler<S, I, tracing::none, 0> scheduler_;
+
+    [[nodiscard]] static constexpr std::size_t round_up_(const std::size_t size) noexcept {
+        return (size + stack_align - 1) / stack_align * stack_align;
+    }
+
+    [[nodiscard]] static std::vector<size_class> validate_(const std::initializer_list<size_class> classes) {
+        if (classes.size() == 0) { throw std::invalid_argument("arena_executor: no size classes"); }
+        return std::vector<size_class>(classes);
+    }
+
+    [[nodiscard]] bool execution_complete_() const noexcept {
+        for (std::size_t index = 0; index < classes_.size(); ++index) {
+            if (pools_[index].live_count() != 0) { return false; }
+        }
+
+        return true;
+    }
+
+    // falls back to larger classes once every context of the smallest fitting one is occupied. A size larger than
+    // every class is given the largest
+    [[nodiscard]] std::optional<coroutine_context> hand_out_(const std::size_t size,
+                                                             std::atomic_size_t* profile) noexcept {
+        std::size_t index = 0;
+        while (index + 1 < classes_.size() && classes_[index].size < size) { ++index; }
+
+        for (; index < classes_.size(); ++index) {
+            detail::context_node* node = pools_[index].peek_idle();
+            if (node == nullptr) { continue; }
+
+            node->stack().profile_ = profile;
+            return coroutine_context{node->stack().view_of(), node};
+        }
+
+        return std::nullopt;
+    }
+
+   public:
+    // a context of the smallest class whose stacks are at least size bytes. The returned context stays available
+    // until a coroutine is spawned onto it
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context(const std::size_t size) noexcept {
+        return hand_out_(size, nullptr);
+    }
+
+    // a context of the smallest class fitting the profile's peak, or of the largest class until a peak is recorded
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context(stack_profile& profile) noexcept {
+        const std::size_t peak = profile.peak();
+        return hand_out_(peak != 0 ? peak : classes_.back().size, &profile.peak_);
+    }
+
+    // a context of the largest class
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context() noexcept {
+        return hand_out_(classes_.back().size, nullptr);
+    }
+
+    // each terminates if every context of a large enough class is occupied
+    [[nodiscard]] coroutine_context find_available_context(const std::size_t size) noexcept {
+        return try_find_available_context(size).value();
+    }
+
+    [[nodiscard]] coroutine_context find_available_context(stack_profile& profile) noexcept {
+        return try_find_available_context(profile).value();
+    }
+
+    [[nodiscard]] coroutine_context find_available_context() noexcept { return try_find_available_context().value(); }
+
+    [[nodiscard]] std::size_t live_context_count() const noexcept {
+        std::size_t live_count = 0;
+        for (std::size_t index = 0; index < classes_.size(); ++index) { live_count += pools_[index].live_count(); }
+        return live_count;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return contexts_.size(); }
+    [[nodiscard]] bool execution_complete() const noexcept { return execution_complete_(); }
+
+    // the size classes, smallest first
+    [[nodiscard]] const std::vector<size_class>& size_classes() const noexcept { return classes_; }
+
+    // the peak number of bytes occupied by the frames of the index-th context, contexts being indexed by size class
+    [[nodiscard]] std::size_t stack_high_water_mark(const std::size_t index) const noexcept {
+        return contexts_.stack(index).high_water_mark();
+    }
+
+    // the peak number of bytes occupied by the frames of any context
+    [[nodiscard]] std::size_t stack_high_water_mark() const noexcept {
+        std::size_t high_water_mark = 0;
+        for (std::size_t index = 0; index < contexts_.size(); ++index) {
+            high_water_mark = std::max(high_water_mark, contexts_.stack(index).high_water_mark());
+        }
+
+        return high_water_mark;
+    }
+
+    // the number of frames which did not fit in their context's stack and were spilled to the heap
+    [[nodiscard]] std::size_t stack_overflow_count() const noexcept {
+        std::size_t overflow_count = 0;
+        for (std::size_t index = 0; index < contexts_.size(); ++index) {
+            overflow_count += contexts_.stack(index).overflow_count();
+        }
+
+        return overflow_count;
+    }
+
+    void step() noexcept { static_cast<void>(scheduler_.step(contexts_)); }
+
+    // polls D (e.g. a nano::io::ring) for completions every step, and blocks in it rather than parking when idle
+    template <typename D>
+    void attach(D& source) noexcept {
+        scheduler_.attach(source);
+    }
+
+    // idles according to I while every live coroutine is waiting, e.g. on an event sent from another thread
+    void wait() noexcept {
+        scheduler_.wait(contexts_, [this] { return execution_complete_(); });
+    }
+
+    arena_executor& operator=(const arena_executor& other) = delete;
+    arena_executor(const arena_executor& other) = delete;
+
+    // the arena holds the contexts' pending flags, followed by their metadata and then their stacks, each stack size
+    // being rounded up to a multiple of 64 bytes. Throws std::invalid_argument given no size classes
+    explicit arena_executor(const std::initializer_list<size_class> classes)
+        : classes_(validate_(classes)), pools_{std::make_unique<detail::context_pool[]>(classes.size())} {
+        std::sort(classes_.begin(), classes_.end(),
+                  [](const size_class& a, const size_class& b) { return a.size < b.size; });
+
+        std::size_t stack_bytes = 0;
+        for (size_class& elem : classes_) {
+            elem.size = round_up_(elem.size);
+            contexts_.count_ += elem.count;
+            stack_bytes += elem.size * elem.count;
+        }
+
+        const std::size_t pending_bytes = round_up_(sizeof(std::atomic_bool) * contexts_.count_);
+        const std::size_t context_bytes = round_up_(sizeof(detail::arena_context) * contexts_.count_);
+        const std::size_t arena_bytes = pending_bytes + context_bytes + stack_bytes;
+        arena_.reset(static_cast<std::byte*>(::operator new[](arena_bytes, std::align_val_t{stack_align})));
+        contexts_.pending_ = reinterpret_cast<std::atomic_bool*>(arena_.get());
+        contexts_.contexts_ = reinterpret_cast<detail::arena_context*>(arena_.get() + pending_bytes);
+
+        std::byte* stack = arena_.get() + pending_bytes + context_bytes;
+        std::size_t index = 0;
+
+        for (std::size_t class_index = 0; class_index < classes_.size(); ++class_index) {
+            const size_class& elem = classes_[class_index];
+            for (std::size_t count = 0; count < elem.count; ++count, ++index, stack += elem.size) {
+                detail::arena_context& context =
+                    *new (&contexts_.contexts_[index]) detail::arena_context(stack, elem.size);
+                std::atomic_bool& pending = *new (&contexts_.pending_[index]) std::atomic_bool{false};
+                context.stack_.overflow_policy_ = detail::overflow_policy_v<O>;
+                scheduler_.adopt(context.node_, pending, index);
+            }
+
+            // adopted in reverse so that contexts are handed out in index order
+            for (std::size_t adopted = index; adopted > index - elem.count; --adopted) {
+                pools_[class_index].adopt(contexts_.node(adopted - 1));
+            }
+        }
+    }
+
+    ~arena_executor() noexcept {
+        for (std::size_t index = 0; index < contexts_.size(); ++index) { contexts_.contexts_[index].~arena_context(); }
+    }
+};
+
+}  // namespace nano
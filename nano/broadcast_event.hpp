@@ -0,0 +1,162 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+#include <nano/mutex.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace nano {
+
+namespace detail {
+
+// hands a completion, made at most once and possibly on another thread, to any number of receivers. Each receiver is
+// queued intrusively in its awaiter, so waiting allocates nothing, and completing wakes them all in one pass
+class broadcast_signal {
+   private:
+    spin_lock lock_{};
+    waiter_queue waiters_{};
+    std::atomic_bool complete_{false};
+
+    [[nodiscard]] std::unique_lock<spin_lock> guard_() noexcept { return std::unique_lock<spin_lock>(lock_); }
+
+   public:
+    [[nodiscard]] bool complete() const noexcept { return complete_.load(std::memory_order_acquire); }
+
+    // returns true, without queueing the waiter, when already complete
+    [[nodiscard]] bool attach(lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (complete_.load(std::memory_order_relaxed)) { return true; }
+
+        waiters_.push(waiter);
+        return false;
+    }
+
+    // returns false when completion won the race, in which case the waiter is (or is about to be) signalled
+    [[nodiscard]] bool detach(lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        return waiters_.remove(waiter);
+    }
+
+    // the broadcast_signal may be destroyed by a receiver as soon as this is called. Returns whether any receiver was
+    // signalled
+    bool notify() noexcept {
+        lock_waiter* waiters = nullptr;
+
+        {
+            const auto guard = guard_();
+            complete_.store(true, std::memory_order_release);
+            waiters = waiters_.pop_all();
+        }
+
+        wake(waiters);
+        return waiters != nullptr;
+    }
+};
+
+// suspends the receiver until a broadcast_signal completes. A waiter is only queued once suspended, when its address
+// is final
+class broadcast_awaiter {
+   private:
+    enum class stage : std::uint8_t { pending, queued, complete };
+
+    broadcast_signal* completion_;
+    lock_waiter waiter_{};
+    stage stage_;
+
+   public:
+    [[nodiscard]] constexpr bool await_ready() const noexcept { return stage_ == stage::complete; }
+
+    // false when complete after all, in which case the receiver resumes immediately
+    [[nodiscard]] bool await_suspend(std::coroutine_handle<>) noexcept {
+        stage_ = completion_->attach(waiter_) ? stage::complete : stage::queued;
+        return stage_ == stage::queued;
+    }
+
+    // returns false when completion won the race, after which delivered (if provided) is set once the waiter has been
+    // signalled
+    [[nodiscard]] bool detach() noexcept { return stage_ == stage::pending || completion_->detach(waiter_); }
+
+    broadcast_awaiter& operator=(const broadcast_awaiter& other) = delete;
+    broadcast_awaiter(const broadcast_awaiter& other) = delete;
+
+    broadcast_awaiter(signal receiver_signal, broadcast_signal& completion,
+                      std::atomic_bool* delivered = nullptr) noexcept
+        : completion_{&completion}, stage_{completion.complete() ? stage::complete : stage::pending} {
+        waiter_.signal_ = receiver_signal;
+        waiter_.delivered_ = delivered;
+        if (stage_ != stage::complete) { receiver_signal.set(false); }
+    }
+};
+
+}  // namespace detail
+
+// a single value sent once, possibly from another thread, to every coroutine awaiting it. Each reads the value in place
+// by const reference, so it must outlive them
+template <typename T>
+class broadcast_event {
+   private:
+    detail::broadcast_signal completion_{};
+    std::optional<T> result_{std::nullopt};
+
+   public:
+    class awaiter_type {
+       private:
+        detail::broadcast_awaiter waiting_;
+        const broadcast_event<T>* event_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return waiting_.await_ready(); }
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            return waiting_.await_suspend(handle);
+        }
+
+        [[nodiscard]] bool detach() noexcept { return waiting_.detach(); }
+        [[nodiscard]] const T& await_resume() const noexcept { return *event_->result_; }
+
+        awaiter_type(detail::signal receiver_signal, broadcast_event<T>& event,
+                     std::atomic_bool* delivered = nullptr) noexcept
+            : waiting_{receiver_signal, event.completion_, delivered}, event_{&event} {}
+    };
+
+    // sent at most once, as waiters may already be reading the value. It is published by the completion, so no waiter
+    // observes a partially stored value
+    template <typename U, std::enable_if_t<std::is_same_v<std::decay_t<U>, T>, T>* = nullptr>
+    void send(U&& value) noexcept {
+        result_ = std::forward<U>(value);
+        completion_.notify();
+    }
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) noexcept {
+        return awaiter_type(receiver_signal, *this, delivered);
+    }
+
+    broadcast_event(const broadcast_event<T>& other) = delete;
+    broadcast_event<T>& operator=(const broadcast_event<T>& other) = delete;
+
+    broadcast_event() = default;
+};
+
+}  // namespace nano
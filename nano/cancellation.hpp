@@ -0,0 +1,273 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+
+namespace nano {
+
+// thrown from the co_await of a coroutine whose cancellation was requested, unwinding it
+class operation_cancelled : public std::exception {
+   public:
+    [[nodiscard]] const char* what() const noexcept override { return "nano: operation cancelled"; }
+};
+
+namespace detail {
+
+class cancellation_state;
+
+// a suspended frame to be signalled ready once cancellation is requested, living in its promise
+struct cancellation_waiter {
+    cancellation_state* state_{nullptr};
+    coroutine_frame_data* frame_{nullptr};
+    cancellation_waiter* prev_{nullptr};
+    cancellation_waiter* next_{nullptr};
+
+    // when set, the operation the frame awaits is interrupted instead, and signals it once complete (see
+    // is_interruptible_v)
+    void (*interrupt_)(void*) noexcept {nullptr};
+    void* interrupted_{nullptr};
+};
+
+// waiters are signalled with the spin lock held, so a waiter withdrawing itself can't be destroyed while signalled
+class cancellation_state {
+   private:
+    std::atomic_bool requested_{false};
+    spin_lock lock_{};
+    cancellation_waiter* head_{nullptr};
+
+    [[nodiscard]] std::unique_lock<spin_lock> guard_() noexcept { return std::unique_lock<spin_lock>(lock_); }
+
+   public:
+    [[nodiscard]] bool requested() const noexcept { return requested_.load(std::memory_order_acquire); }
+
+    // false, without enlisting, once cancellation has been requested
+    [[nodiscard]] bool enlist(cancellation_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (requested()) { return false; }
+
+        waiter.prev_ = nullptr;
+        waiter.next_ = head_;
+        if (head_ != nullptr) { head_->prev_ = &waiter; }
+
+        head_ = &waiter;
+        return true;
+    }
+
+    // a waiter is no longer linked once cancellation has been requested
+    void withdraw(cancellation_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (head_ != &waiter && waiter.prev_ == nullptr) { return; }
+
+        if (waiter.prev_ == nullptr) {
+            head_ = waiter.next_;
+        } else {
+            waiter.prev_->next_ = waiter.next_;
+        }
+
+        if (waiter.next_ != nullptr) { waiter.next_->prev_ = waiter.prev_; }
+        waiter.prev_ = nullptr;
+        waiter.next_ = nullptr;
+    }
+
+    void request() noexcept {
+        const auto guard = guard_();
+        if (requested_.exchange(true, std::memory_order_acq_rel)) { return; }
+
+        cancellation_waiter* waiter = head_;
+        head_ = nullptr;
+
+        while (waiter != nullptr) {
+            cancellation_waiter* next = waiter->next_;
+            waiter->prev_ = nullptr;
+            waiter->next_ = nullptr;
+
+            if (waiter->interrupt_ != nullptr) {
+                waiter->interrupt_(waiter->interrupted_);
+            } else {
+                waiter->frame_->ready_signal().set(true);
+            }
+            waiter = next;
+        }
+    }
+};
+
+}  // namespace detail
+
+// observes the cancellation_source it was obtained from, which must outlive it
+class cancellation_token {
+   private:
+    detail::cancellation_state* state_{nullptr};
+
+   public:
+    [[nodiscard]] constexpr bool can_be_cancelled() const noexcept { return state_ != nullptr; }
+    [[nodiscard]] bool cancellation_requested() const noexcept { return state_ != nullptr && state_->requested(); }
+
+    // for loops which would otherwise run to completion without awaiting
+    void throw_if_cancellation_requested() const {
+        if (cancellation_requested()) { throw operation_cancelled(); }
+    }
+
+    [[nodiscard]] constexpr detail::cancellation_state* state() const noexcept { return state_; }
+
+    constexpr cancellation_token() noexcept = default;
+    explicit constexpr cancellation_token(detail::cancellation_state* state) noexcept : state_{state} {}
+};
+
+// requests cancellation of every coroutine spawned onto a context carrying one of its tokens (see
+// coroutine_context::with_cancellation). Such a coroutine suspended on an event, a lock or a yield is resumed (or has
+// its I/O request cancelled in flight), and each of its co_awaits from then on throws operation_cancelled, unwinding it
+// and popping its frame
+class cancellation_source {
+   private:
+    detail::cancellation_state state_{};
+
+   public:
+    [[nodiscard]] cancellation_token token() noexcept { return cancellation_token{&state_}; }
+    [[nodiscard]] bool cancellation_requested() const noexcept { return state_.requested(); }
+
+    // may be called from any thread, any number of times
+    void request_cancellation() noexcept { state_.request(); }
+
+    cancellation_source& operator=(const cancellation_source& other) = delete;
+    cancellation_source(const cancellation_source& other) = delete;
+
+    cancellation_source() = default;
+};
+
+namespace detail {
+
+// an awaitable whose awaiter can be withdrawn before completing, as by a timeout. A continuation is excluded, as its
+// receiver can't abandon it: the child observes the cancellation itself and completes without a result
+template <typename A>
+inline constexpr bool is_abandonable_v = requires(A& awaitable, signal receiver_signal, std::atomic_bool* delivered) {
+    awaitable.awaiter(receiver_signal, delivered).detach();
+};
+
+// an awaitable whose operation can't be withdrawn, but can be asked (from any thread) to complete early, as an I/O
+// request in flight is cancelled by its ring
+template <typename A>
+inline constexpr bool is_interruptible_v = requires(A& awaitable, signal receiver_signal) {
+    awaitable.awaiter(receiver_signal).interrupt();
+};
+
+// every co_await of a continuation is wrapped, cancellation being a property of its context only known at run time.
+// Once cancellation is requested, an abandonable awaitable is withdrawn (unless it completed regardless), an
+// interruptible one is interrupted and any other is left to complete, after which the await throws
+// operation_cancelled
+template <typename A>
+class cancellable_awaiter {
+   private:
+    using inner_awaiter_type = typename A::awaiter_type;
+    static constexpr bool abandonable = is_abandonable_v<A>;
+    static constexpr bool interruptible = !abandonable && is_interruptible_v<A>;
+
+    std::atomic_bool delivered_{false};
+    bool enlisted_{false};
+    cancellation_waiter* waiter_;
+    inner_awaiter_type inner_;
+
+    [[nodiscard]] bool requested_() const noexcept { return waiter_ != nullptr && waiter_->state_->requested(); }
+
+    static void interrupt_(void* inner) noexcept { static_cast<inner_awaiter_type*>(inner)->interrupt(); }
+
+    [[nodiscard]] static inner_awaiter_type inner_of_(A& awaitable, signal receiver_signal,
+                                                      std::atomic_bool* delivered) {
+        if constexpr (abandonable) {
+            return awaitable.awaiter(receiver_signal, delivered);
+        } else {
+            return awaitable.awaiter(receiver_signal);
+        }
+    }
+
+   public:
+    [[nodiscard]] bool await_ready() const noexcept {
+        if (inner_.await_ready()) { return true; }
+        return (abandonable || interruptible) && requested_();
+    }
+
+    // a request arriving before the waiter is enlisted signals the receiver (or interrupts the operation) here instead
+    decltype(auto) await_suspend(std::coroutine_handle<> handle) noexcept {
+        if constexpr (abandonable || interruptible) {
+            if (waiter_ != nullptr) {
+                if constexpr (interruptible) {
+                    waiter_->interrupt_ = &interrupt_;
+                    waiter_->interrupted_ = &inner_;
+                }
+
+                enlisted_ = waiter_->state_->enlist(*waiter_);
+                if (!enlisted_) {
+                    if constexpr (abandonable) {
+                        waiter_->frame_->ready_signal().set(true);
+                    } else {
+                        inner_.interrupt();
+                    }
+                }
+            }
+        }
+
+        return inner_.await_suspend(handle);
+    }
+
+    decltype(auto) await_resume() {
+        if (enlisted_) { waiter_->state_->withdraw(*waiter_); }
+        if constexpr (interruptible) {
+            if (waiter_ != nullptr) { waiter_->interrupt_ = nullptr; }
+        }
+
+        if (!requested_()) {
+            // delivered is set just after the receiver is signalled, so is awaited before it goes out of scope
+            if constexpr (abandonable) {
+                if (waiter_ != nullptr && !inner_.await_ready()) {
+                    while (!delivered_.load(std::memory_order_acquire)) {}
+                }
+            }
+
+            return inner_.await_resume();
+        }
+
+        if constexpr (abandonable) {
+            if (!inner_.await_ready()) {
+                if (inner_.detach()) { throw operation_cancelled(); }
+                while (!delivered_.load(std::memory_order_acquire)) {}
+            }
+        }
+
+        // the result of an operation which completed regardless is discarded, releasing whatever it holds
+        static_cast<void>(inner_.await_resume());
+        throw operation_cancelled();
+    }
+
+    cancellable_awaiter& operator=(const cancellable_awaiter& other) = delete;
+    cancellable_awaiter(const cancellable_awaiter& other) = delete;
+
+    // waiter is the receiver's, or nullptr when it can't be cancelled (in which case the awaitable is never abandoned,
+    // and doesn't report delivery)
+    cancellable_awaiter(A& awaitable, signal receiver_signal, cancellation_waiter* waiter)
+        : waiter_{waiter}, inner_{inner_of_(awaitable, receiver_signal, waiter != nullptr ? &delivered_ : nullptr)} {}
+};
+
+}  // namespace detail
+
+}  // namespace nano
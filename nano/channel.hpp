@@ -0,0 +1,370 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+#include <nano/mutex.hpp>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace nano {
+
+namespace detail {
+
+// a suspended sender or receiver queued on a channel, living in the awaiter of its frame. A sender's value is moved
+// out once accepted; a receiver is handed values directly, into value_ or, when receiving many, into items_
+template <typename T>
+struct channel_waiter {
+    signal signal_{signal::make_detached()};
+    std::atomic_bool* delivered_{nullptr};
+    channel_waiter<T>* next_{nullptr};
+
+    std::optional<T>* value_{nullptr};
+    T* items_{nullptr};
+    std::size_t capacity_{1};
+    std::size_t count_{0};
+};
+
+}  // namespace detail
+
+// Bounded queue of up to N values between coroutines running on the same thread, stored inline without allocating.
+// Sending suspends while the channel is full and receiving suspends while it is empty, and only the side which is
+// blocked is woken: a receiver is handed values directly by the senders, and a sender is resumed once a receiver made
+// room for its value. Once closed, sending fails and receiving yields what remains buffered before std::nullopt.
+template <typename T, std::size_t N>
+class channel {
+   private:
+    static_assert(N > 0);
+
+    using waiter_type = detail::channel_waiter<T>;
+
+    struct slot {
+        alignas(T) std::byte storage[sizeof(T)];
+
+        [[nodiscard]] T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    std::array<slot, N> slots_;
+    std::size_t head_{0};
+    std::size_t size_{0};
+    bool closed_{false};
+
+    detail::basic_waiter_queue<waiter_type> senders_{};
+    detail::basic_waiter_queue<waiter_type> receivers_{};
+
+    // the waiter's fields are read first, as it may be destroyed once its coroutine resumes
+    static void wake_(waiter_type& waiter) noexcept {
+        const detail::signal woken = waiter.signal_;
+        std::atomic_bool* const delivered = waiter.delivered_;
+
+        woken.set(true);
+        if (delivered != nullptr) { delivered->store(true, std::memory_order_release); }
+    }
+
+    void push_(T&& value) {
+        ::new (static_cast<void*>(slots_[(head_ + size_) % N].storage)) T(std::move(value));
+        ++size_;
+    }
+
+    [[nodiscard]] T pop_() {
+        T* const source = slots_[head_].value();
+        T value{std::move(*source)};
+        std::destroy_at(source);
+
+        head_ = (head_ + 1) % N;
+        --size_;
+        return value;
+    }
+
+    // a receiver only waits while the channel is empty, so is handed the value directly. One receiving many stays at
+    // the front, and keeps being handed values, until it is full or resumes
+    void deliver_(T&& value) {
+        waiter_type& receiver = receivers_.front();
+        if (receiver.value_ != nullptr) {
+            receiver.value_->emplace(std::move(value));
+        } else {
+            receiver.items_[receiver.count_] = std::move(value);
+        }
+
+        const bool first = receiver.count_++ == 0;
+        if (receiver.count_ == receiver.capacity_) { static_cast<void>(receivers_.pop()); }
+        if (first) { wake_(receiver); }
+    }
+
+    // value is only moved from when accepted
+    [[nodiscard]] bool offer_(T& value) {
+        if (closed_) { return false; }
+
+        if (!receivers_.empty()) {
+            deliver_(std::move(value));
+        } else if (size_ < N) {
+            push_(std::move(value));
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    // the room made is handed to the longest waiting sender, which is only resumed once its value is accepted
+    [[nodiscard]] std::optional<T> take_() {
+        if (size_ == 0) { return std::nullopt; }
+
+        std::optional<T> value{pop_()};
+        if (!senders_.empty()) {
+            waiter_type* const sender = senders_.pop();
+            push_(std::move(**sender->value_));
+            sender->count_ = 1;
+            wake_(*sender);
+        }
+
+        return value;
+    }
+
+   public:
+    class send_request;
+    class receive_request;
+    class receive_many_request;
+
+    // returns false when the channel is full or closed
+    [[nodiscard]] bool try_send(T value) { return offer_(value); }
+
+    [[nodiscard]] std::optional<T> try_receive() { return take_(); }
+
+    // awaiting it yields false, leaving the value unsent, when the channel is closed first
+    [[nodiscard]] send_request send(T value) { return send_request(*this, std::move(value)); }
+
+    // awaiting it yields std::nullopt once the channel is closed and drained
+    [[nodiscard]] receive_request receive() noexcept { return receive_request(*this); }
+
+    // awaiting it yields the number of values received into items (at least one, unless the channel is closed and
+    // drained), so a receiver is resumed once per batch rather than once per value
+    [[nodiscard]] receive_many_request receive_many(std::span<T> items) noexcept {
+        return receive_many_request(*this, items);
+    }
+
+    // waiting senders fail and waiting receivers observe the end of the channel, though values already buffered can
+    // still be received
+    void close() noexcept {
+        closed_ = true;
+
+        while (!senders_.empty()) { wake_(*senders_.pop()); }
+
+        while (!receivers_.empty()) {
+            waiter_type* const receiver = receivers_.pop();
+            if (receiver->count_ == 0) { wake_(*receiver); }
+        }
+    }
+
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] constexpr bool closed() const noexcept { return closed_; }
+    [[nodiscard]] static constexpr std::size_t capacity() noexcept { return N; }
+
+    channel<T, N>& operator=(const channel<T, N>& other) = delete;
+    channel(const channel<T, N>& other) = delete;
+
+    channel() = default;
+
+    ~channel() noexcept {
+        while (size_ != 0) { static_cast<void>(pop_()); }
+    }
+};
+
+template <typename T, std::size_t N>
+class channel<T, N>::send_request {
+   private:
+    channel<T, N>* channel_;
+    T value_;
+
+   public:
+    // a waiter is only queued once suspended, when its address is final
+    class awaiter_type {
+       private:
+        enum class stage : std::uint8_t { pending, queued, complete };
+
+        channel<T, N>* channel_;
+        std::optional<T> value_;
+        waiter_type waiter_{};
+        stage stage_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return stage_ == stage::complete; }
+        [[nodiscard]] constexpr bool await_resume() const noexcept { return waiter_.count_ != 0; }
+
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            waiter_.value_ = &value_;
+            channel_->senders_.push(waiter_);
+            stage_ = stage::queued;
+        }
+
+        // returns false when the value was accepted (or the channel closed) first
+        [[nodiscard]] bool detach() noexcept { return stage_ == stage::pending || channel_->senders_.remove(waiter_); }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(detail::signal receiver_signal, channel<T, N>& target, T&& value,
+                     std::atomic_bool* delivered = nullptr)
+            : channel_{&target}, value_{std::move(value)}, stage_{stage::complete} {
+            waiter_.signal_ = receiver_signal;
+            waiter_.delivered_ = delivered;
+
+            if (target.offer_(*value_)) {
+                waiter_.count_ = 1;
+            } else if (!target.closed_) {
+                stage_ = stage::pending;
+                receiver_signal.set(false);
+            }
+        }
+    };
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        return awaiter_type(receiver_signal, *channel_, std::move(value_), delivered);
+    }
+
+    send_request(channel<T, N>& target, T&& value) : channel_{&target}, value_{std::move(value)} {}
+};
+
+template <typename T, std::size_t N>
+class channel<T, N>::receive_request {
+   private:
+    channel<T, N>* channel_;
+
+   public:
+    class awaiter_type {
+       private:
+        enum class stage : std::uint8_t { pending, queued, complete };
+
+        channel<T, N>* channel_;
+        std::optional<T> value_;
+        waiter_type waiter_{};
+        stage stage_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return stage_ == stage::complete; }
+        [[nodiscard]] std::optional<T> await_resume() noexcept { return std::move(value_); }
+
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            waiter_.value_ = &value_;
+            channel_->receivers_.push(waiter_);
+            stage_ = stage::queued;
+        }
+
+        // returns false when handed a value (or the channel closed) first
+        [[nodiscard]] bool detach() noexcept {
+            return stage_ == stage::pending || channel_->receivers_.remove(waiter_);
+        }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(detail::signal receiver_signal, channel<T, N>& source, std::atomic_bool* delivered = nullptr)
+            : channel_{&source}, value_{source.take_()}, stage_{stage::complete} {
+            waiter_.signal_ = receiver_signal;
+            waiter_.delivered_ = delivered;
+
+            if (!value_.has_value() && !source.closed_) {
+                stage_ = stage::pending;
+                receiver_signal.set(false);
+            }
+        }
+    };
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        return awaiter_type(receiver_signal, *channel_, delivered);
+    }
+
+    explicit receive_request(channel<T, N>& source) noexcept : channel_{&source} {}
+};
+
+template <typename T, std::size_t N>
+class channel<T, N>::receive_many_request {
+   private:
+    channel<T, N>* channel_;
+    std::span<T> items_;
+
+   public:
+    class awaiter_type {
+       private:
+        enum class stage : std::uint8_t { pending, queued, complete };
+
+        channel<T, N>* channel_;
+        waiter_type waiter_{};
+        stage stage_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return stage_ == stage::complete; }
+
+        // a receiver still at the front of the queue when resumed stops being handed values here
+        [[nodiscard]] std::size_t await_resume() noexcept {
+            if (stage_ == stage::queued) { static_cast<void>(channel_->receivers_.remove(waiter_)); }
+            return waiter_.count_;
+        }
+
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            channel_->receivers_.push(waiter_);
+            stage_ = stage::queued;
+        }
+
+        // returns false when handed any value (or the channel closed) first
+        [[nodiscard]] bool detach() noexcept {
+            if (stage_ == stage::pending) { return true; }
+            return channel_->receivers_.remove(waiter_) && waiter_.count_ == 0;
+        }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(detail::signal receiver_signal, channel<T, N>& source, std::span<T> items,
+                     std::atomic_bool* delivered = nullptr)
+            : channel_{&source}, stage_{stage::complete} {
+            waiter_.signal_ = receiver_signal;
+            waiter_.delivered_ = delivered;
+            waiter_.items_ = items.data();
+            waiter_.capacity_ = items.size();
+
+            while (waiter_.count_ < items.size()) {
+                std::optional<T> value = source.take_();
+                if (!value.has_value()) { break; }
+                items[waiter_.count_++] = std::move(*value);
+            }
+
+            if (waiter_.count_ == 0 && !items.empty() && !source.closed_) {
+                stage_ = stage::pending;
+                receiver_signal.set(false);
+            }
+        }
+    };
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        return awaiter_type(receiver_signal, *channel_, items_, delivered);
+    }
+
+    receive_many_request(channel<T, N>& source, std::span<T> items) noexcept : channel_{&source}, items_{items} {}
+};
+
+}  // namespace nano
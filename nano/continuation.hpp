@@ -17,117 +17,180 @@
 
 #pragma once
 
+#include <nano/cancellation.hpp>
 #include <nano/detail.hpp>
 #include <nano/execution.hpp>
 #include <nano/executor.hpp>
+#include <nano/tracing.hpp>
 
+#include <atomic>
 #include <coroutine>
 #include <optional>
+#include <utility>
 
 namespace nano {
 
 template <typename T, typename E = execution::eager>
-class continuation {
-   public:
-    using return_type = T;
+class continuation;
 
-    class promise_type;
-    class awaiter_type;
+namespace detail {
 
-    using handle_type = std::coroutine_handle<promise_type>;
+// promise of a coroutine returned as R, whose result is published through the completion C: a completion_signal handing
+// it to a single receiver, or a broadcast_signal handing it to any number of them
+template <typename R, typename T, typename E, typename C>
+class coroutine_promise {
+   public:
+    using handle_type = std::coroutine_handle<coroutine_promise<R, T, E, C>>;
 
    private:
-    handle_type handle_;
+    coroutine_context context_;
+    std::optional<T> result_;
+
+    C completion_;
+    coroutine_stack_frame_header_view frame_data_view_;
+    cancellation_waiter cancellation_waiter_{};
+
+    struct final_awaiter_type {
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return false; }
+        constexpr void await_resume() const noexcept {}
+
+        // the frame is only popped and the receiver only signalled once this coroutine is fully suspended, as the
+        // receiver may destroy it from another thread as soon as it observes the completion. Control then passes
+        // straight to the frame beneath when the completion made it ready (typically, when it is the receiver). A
+        // coroutine completing before any receiver attached returns to its caller instead: the frame beneath, though
+        // ready, is the one still running it
+        [[nodiscard]] std::coroutine_handle<> await_suspend(handle_type handle) const noexcept {
+            coroutine_promise& promise = handle.promise();
+            context_node* const node = promise.context_.node;
+            if constexpr (tracing::hooks_v) {
+                if (node != nullptr && node->trace_ != nullptr) { ++node->trace_->counters_.completions; }
+            }
+
+            promise.context_.stack.get().pop();
+            const bool signalled = promise.completion_.notify();
+            return node != nullptr && signalled ? node->transfer_target() : std::noop_coroutine();
+        }
+    };
 
    public:
-    class promise_type {
-       private:
-        coroutine_context context_;
-        std::optional<T> result_;
+    [[nodiscard]] constexpr std::optional<T>& get_result() noexcept { return result_; }
+    [[nodiscard]] bool complete() const noexcept { return completion_.complete(); }
 
-        detail::signal receiver_signal_;
-        detail::coroutine_stack_frame_header_view frame_data_view_;
+    [[nodiscard]] bool attach_receiver_signal(signal receiver_signal, std::atomic_bool* delivered = nullptr) noexcept {
+        return completion_.attach(receiver_signal, delivered);
+    }
 
-       public:
-        [[nodiscard]] constexpr std::optional<T>& get_result() noexcept { return result_; }
+    [[nodiscard]] bool detach_receiver_signal() noexcept { return completion_.detach(); }
+    [[nodiscard]] C& completion() noexcept { return completion_; }
 
-        void attach_receiver_signal(detail::signal receiver_signal) noexcept {
-            receiver_signal_ = receiver_signal;
-            receiver_signal_.set(result_.has_value());
-        }
+    // a coroutine awaited from the context it was spawned onto is resumed directly when its frame is the ready top,
+    // as is a lazy coroutine yet to start
+    [[nodiscard]] std::coroutine_handle<> transfer_target() const noexcept {
+        return context_.node != nullptr ? context_.node->transfer_target() : std::noop_coroutine();
+    }
 
-        [[nodiscard]] continuation<T, E> get_return_object() {
-            auto coroutine_handle = handle_type::from_promise(*this);
-            return continuation<T, E>{coroutine_handle};
-        }
+    [[nodiscard]] R get_return_object() {
+        auto coroutine_handle = handle_type::from_promise(*this);
+        return R{coroutine_handle};
+    }
 
-        void return_value(T value) {
-            receiver_signal_.set(true);
-            result_ = std::move(value);
-            context_.stack.get().pop();
-        }
+    void return_value(T value) { result_ = std::move(value); }
 
-        template <typename O>
-        [[nodiscard]] typename std::decay_t<O>::awaiter_type await_transform(O&& object) noexcept {
-            const auto ready_signal = frame_data_view_.get().data().ready_signal();
-            return object.awaiter(ready_signal);
-        }
+    template <typename O>
+    [[nodiscard]] cancellable_awaiter<std::decay_t<O>> await_transform(O&& object) {
+        const auto ready_signal = frame_data_view_.get().data().ready_signal();
+        cancellation_waiter* waiter = context_.token.can_be_cancelled() ? &cancellation_waiter_ : nullptr;
+        return cancellable_awaiter<std::decay_t<O>>(object, ready_signal, waiter);
+    }
 
-        template <typename T1, typename E1>
-        [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(continuation<T1, E1>& object) =
-            delete;
+    template <typename T1, typename E1>
+    [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(continuation<T1, E1>& object) = delete;
 
-        template <typename T1, typename E1>
-        [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(const continuation<T1, E1>& object) =
-            delete;
+    template <typename T1, typename E1>
+    [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(const continuation<T1, E1>& object) =
+        delete;
 
-        constexpr void unhandled_exception() {}
-        [[nodiscard]] constexpr execution::await_expression<E>::type initial_suspend() { return {}; }
-        [[nodiscard]] constexpr std::suspend_always final_suspend() noexcept { return {}; }
+    constexpr void unhandled_exception() {}
 
-        promise_type(promise_type&& other) = delete;
-        promise_type(const promise_type& other) = delete;
-        promise_type& operator=(promise_type&& other) = delete;
-        promise_type& operator=(const promise_type& other) = delete;
+    [[nodiscard]] start_awaiter initial_suspend() noexcept {
+        const bool start_inline = context_.node == nullptr || context_.node->may_start_inline();
+        const auto ready_signal = frame_data_view_.get().data().ready_signal();
+        return start_awaiter(execution::is_eager_v<E> && start_inline, ready_signal);
+    }
 
-        [[nodiscard]] void* operator new(std::size_t n, coroutine_context context, auto&&...) {
-            return context.stack.get().push(n, std::alignment_of_v<promise_type>);
-        }
+    [[nodiscard]] constexpr final_awaiter_type final_suspend() const noexcept { return {}; }
+
+    coroutine_promise(coroutine_promise&& other) = delete;
+    coroutine_promise(const coroutine_promise& other) = delete;
+    coroutine_promise& operator=(coroutine_promise&& other) = delete;
+    coroutine_promise& operator=(const coroutine_promise& other) = delete;
+
+    [[nodiscard]] void* operator new(std::size_t n, coroutine_context context, auto&&...) {
+        return allocate_frame(context.stack.get(), n, std::alignment_of_v<coroutine_promise>);
+    }
 
-        constexpr promise_type(coroutine_context context, auto&&...) noexcept
-            : context_{context},
-              result_{std::nullopt},
-              receiver_signal_{detail::signal::make_detached()},
-              frame_data_view_{context.stack.get().peek_frame_header_view()} {
-            const auto handle = std::coroutine_handle<promise_type>::from_promise(*this);
-            frame_data_view_.get().data().ready.store(true, std::memory_order_relaxed);
-            frame_data_view_.get().data().handle = handle;
+    constexpr coroutine_promise(coroutine_context context, auto&&...) noexcept
+        : context_{context},
+          result_{std::nullopt},
+          frame_data_view_{context.stack.get().peek_frame_header_view()} {
+        const auto handle = handle_type::from_promise(*this);
+        frame_data_view_.get().data().handle = handle;
+        frame_data_view_.get().data().node = context.node;
+        cancellation_waiter_.state_ = context.token.state();
+        cancellation_waiter_.frame_ = &frame_data_view_.get().data();
+        if constexpr (tracing::hooks_v) {
+            context_node* const node = context.node;
+            if (node != nullptr && node->trace_ != nullptr) { ++node->trace_->counters_.spawns; }
         }
+    }
 
-        void operator delete(void*) {}
-    };
+    void operator delete(void* ptr, std::size_t n) noexcept { deallocate_frame(ptr, n); }
+};
+
+}  // namespace detail
+
+template <typename T, typename E>
+class continuation {
+   public:
+    using return_type = T;
+
+    using promise_type = detail::coroutine_promise<continuation<T, E>, T, E, detail::completion_signal>;
+    class awaiter_type;
+
+    using handle_type = std::coroutine_handle<promise_type>;
 
+   private:
+    handle_type handle_;
+
+   public:
     class awaiter_type {
        private:
-        detail::optional_view<T> result_;
+        detail::view<promise_type> promise_;
+        bool ready_;
 
        public:
-        [[nodiscard]] constexpr bool await_ready() const noexcept { return result_.get().has_value(); }
-
-        [[nodiscard]] constexpr T&& await_resume() noexcept {
-            auto& result = result_.get().value();
-            return std::move(result);
+        // only ready when complete before attaching, as the receiver's signal is otherwise still to be set
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+        [[nodiscard]] bool detach() noexcept { return promise_.get().detach_receiver_signal(); }
+
+        // a coroutine which completed without a result was cancelled
+        [[nodiscard]] constexpr T&& await_resume() {
+            auto& result = promise_.get().get_result();
+            if (!result.has_value()) { throw operation_cancelled(); }
+            return std::move(*result);
         }
 
-        constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+        [[nodiscard]] std::coroutine_handle<> await_suspend(std::coroutine_handle<>) const noexcept {
+            return promise_.get().transfer_target();
+        }
 
-        awaiter_type(detail::optional_view<T> result_view) noexcept : result_{result_view} {}
+        awaiter_type(detail::view<promise_type> promise_view, const bool ready) noexcept
+            : promise_{promise_view}, ready_{ready} {}
     };
 
-    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) {
-        handle_.promise().attach_receiver_signal(receiver_signal);
-        auto result_view = detail::view(handle_.promise().get_result());
-        return awaiter_type{result_view};
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        const bool ready = handle_.promise().attach_receiver_signal(receiver_signal, delivered);
+        return awaiter_type{detail::view(handle_.promise()), ready};
     }
 
     continuation(continuation<T, E>&& other) = delete;
@@ -136,8 +199,21 @@ class continuation {
     continuation<T>& operator=(continuation<T, E>&& other) = delete;
     continuation<T>& operator=(const continuation<T, E>& other) = delete;
 
+    // hands ownership of the coroutine over (e.g. to a nano::task), leaving the continuation empty
+    [[nodiscard]] handle_type release() noexcept { return std::exchange(handle_, nullptr); }
+
     continuation(handle_type coroutine_handle) noexcept : handle_{coroutine_handle} {}
-    ~continuation() noexcept { handle_.destroy(); }
+
+    ~continuation() noexcept {
+        if (handle_) { handle_.destroy(); }
+    }
 };
 
+namespace detail {
+
+template <typename T, typename E>
+inline constexpr bool is_abandonable_v<continuation<T, E>> = false;
+
+}  // namespace detail
+
 }  // namespace nano
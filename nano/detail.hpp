@@ -17,12 +17,27 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <nano/idle.hpp>
+#include <nano/overflow.hpp>
+#include <nano/tracing.hpp>
 #include <new>
 #include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace nano {
 
@@ -41,44 +56,76 @@ struct view {
 template <typename T>
 using optional_view = view<std::optional<T>>;
 
+struct context_node;
+class countdown;
+
 struct signal {
     static inline thread_local std::atomic_bool detached_target_ = false;
 
     std::atomic_bool* state_;
+    context_node* node_{nullptr};
+    countdown* countdown_{nullptr};
 
-    void set(const bool value) noexcept { state_->store(value, std::memory_order_relaxed); }
+    void set(const bool value) const noexcept;
     signal(std::atomic_bool& ref) noexcept : state_{&ref} {}
+    signal(std::atomic_bool& ref, context_node* node) noexcept : state_{&ref}, node_{node} {}
+    signal(std::atomic_bool& ref, countdown* target) noexcept : state_{&ref}, countdown_{target} {}
 
     static signal make_detached() { return signal(detached_target_); };
 };
 
+// a block of a data_stack's memory. Blocks may be released in any order, the stack's tail only falling back past a
+// block once it and every block above it have been released
+struct stack_reservation {
+    stack_reservation* below_{nullptr};
+    std::byte* start_{nullptr};
+    bool released_{false};
+};
+
 template <typename T>
 struct data_stack_frame_header {
     using data_type = T;
 
     data_stack_frame_header<T>* ancestor_frame_header_;
-    std::byte* ancestor_tail_{nullptr};
+
+    // the block holding the header and its frame, unused when both live elsewhere (see push_external)
+    stack_reservation reservation_{};
 
     T data_{};
 
     [[nodiscard]] const T& data() const noexcept { return data_; }
     [[nodiscard]] T& data() noexcept { return data_; }
 
-    [[nodiscard]] std::byte* ancestor_tail() const noexcept { return ancestor_tail_; }
     [[nodiscard]] data_stack_frame_header<T>* ancestor_frame_header() const noexcept { return ancestor_frame_header_; }
 
-    data_stack_frame_header(data_stack_frame_header<T>* ancestor_frame_header, std::byte* ancestor_tail) noexcept
-        : ancestor_frame_header_{ancestor_frame_header}, ancestor_tail_{ancestor_tail} {}
+    explicit data_stack_frame_header(data_stack_frame_header<T>* ancestor_frame_header) noexcept
+        : ancestor_frame_header_{ancestor_frame_header} {}
 };
 
 template <typename T>
 struct data_stack {
     data_stack_frame_header<T>* current_frame_header_{nullptr};
+    stack_reservation* top_reservation_{nullptr};
 
     std::byte* tail_;
     std::byte* end_;
     std::size_t space_;
 
+    void reserve_(stack_reservation& reservation, std::byte* start) noexcept {
+        reservation.below_ = top_reservation_;
+        reservation.start_ = start;
+        reservation.released_ = false;
+        top_reservation_ = &reservation;
+    }
+
+    // a block reserved by reserve_block is followed by its reservation
+    [[nodiscard]] static stack_reservation& block_reservation_(void* block, const std::size_t size) noexcept {
+        constexpr std::size_t reservation_align = std::alignment_of_v<stack_reservation>;
+        const auto end = reinterpret_cast<std::uintptr_t>(block) + size;
+        const auto place = (end + reservation_align - 1) / reservation_align * reservation_align;
+        return *std::launder(reinterpret_cast<stack_reservation*>(place));
+    }
+
     [[nodiscard]] void* allocate_(const std::size_t size, const std::size_t align) noexcept {
         void* unaligned_ptr = tail_;
         std::byte* aligned_ptr = reinterpret_cast<std::byte*>(std::align(align, size, unaligned_ptr, space_));
@@ -102,29 +149,71 @@ struct data_stack {
         return view(*current_frame_header_);
     }
 
-    [[nodiscard]] void* push(const std::size_t size, const std::size_t align) {
+    // returns nullptr when the frame does not fit in the remaining space
+    [[nodiscard]] void* push(const std::size_t size, const std::size_t align) noexcept {
         constexpr std::size_t frame_header_size = sizeof(data_stack_frame_header<T>);
         constexpr std::size_t frame_header_align = std::alignment_of_v<data_stack_frame_header<T>>;
 
         data_stack_frame_header<T>* ancestor_frame_header = current_frame_header_;
         std::byte* ancestor_tail = tail_;
+        const std::size_t ancestor_space = space_;
 
         void* header_place = allocate_(frame_header_size, frame_header_align);
-        current_frame_header_ = new (header_place) data_stack_frame_header<T>(ancestor_frame_header, ancestor_tail);
+        void* frame = header_place != nullptr ? allocate_(size, align) : nullptr;
+
+        // nothing is pushed when the frame does not fit
+        if (frame == nullptr) {
+            tail_ = ancestor_tail;
+            space_ = ancestor_space;
+            return nullptr;
+        }
+
+        current_frame_header_ = new (header_place) data_stack_frame_header<T>(ancestor_frame_header);
+        reserve_(current_frame_header_->reservation_, ancestor_tail);
+        return frame;
+    }
+
+    // pushes a frame whose header was allocated elsewhere, leaving the stack's memory untouched
+    void push_external(void* header_place) noexcept {
+        current_frame_header_ = new (header_place) data_stack_frame_header<T>(current_frame_header_);
+    }
+
+    // the frame's memory stays reserved until it is released (once the frame is destroyed), as a popped frame may
+    // still be read, e.g. for the result of a held nano::task
+    void pop() noexcept { current_frame_header_ = current_frame_header_->ancestor_frame_header(); }
+
+    // memory without a frame header, released with release_block. Returns nullptr when it does not fit
+    [[nodiscard]] void* reserve_block(const std::size_t size, const std::size_t align) noexcept {
+        std::byte* start = tail_;
+        const std::size_t start_space = space_;
 
-        return allocate_(size, align);
+        void* block = allocate_(size, align);
+        void* place = block != nullptr ? allocate_(sizeof(stack_reservation), alignof(stack_reservation)) : nullptr;
+
+        if (place == nullptr) {
+            tail_ = start;
+            space_ = start_space;
+            return nullptr;
+        }
+
+        reserve_(*new (place) stack_reservation{}, start);
+        return block;
     }
 
-    void pop() {
-        auto& header = *current_frame_header_;
+    // the tail falls back past every released block at the top of the stack, along with anything bumped above them
+    void release(stack_reservation& reservation) noexcept {
+        reservation.released_ = true;
 
-        current_frame_header_ = header.ancestor_frame_header();
-        tail_ = header.ancestor_tail();
+        while (top_reservation_ != nullptr && top_reservation_->released_) {
+            tail_ = top_reservation_->start_;
+            top_reservation_ = top_reservation_->below_;
+        }
 
-        header.~data_stack_frame_header();
         space_ = std::distance(tail_, end_);
     }
 
+    void release_block(void* block, const std::size_t size) noexcept { release(block_reservation_(block, size)); }
+
     [[nodiscard]] view<data_stack<T>> view_of() noexcept { return view(*this); }
 
     data_stack<T>& operator=(const data_stack<T>& other) = delete;
@@ -144,27 +233,833 @@ struct data_stack {
 struct coroutine_frame_data {
     std::atomic_bool ready;
     std::coroutine_handle<> handle;
+    context_node* node{nullptr};
 
-    signal ready_signal() noexcept { return signal(ready); }
+    signal ready_signal() noexcept { return signal(ready, node); }
 };
 
 using coroutine_stack_frame_header = data_stack_frame_header<coroutine_frame_data>;
 using coroutine_stack_frame_header_view = view<coroutine_stack_frame_header>;
 
-using coroutine_stack = data_stack<coroutine_frame_data>;
+enum class overflow_policy { terminate, spill, fail };
+
+template <typename O>
+inline constexpr overflow_policy overflow_policy_v = std::is_same_v<O, overflow::spill>  ? overflow_policy::spill
+                                                     : std::is_same_v<O, overflow::fail> ? overflow_policy::fail
+                                                                                          : overflow_policy::terminate;
+
+// a data_stack which reports to its context_node when it becomes occupied, when it runs empty and once the memory of
+// its frames may be reused (when the last coroutine allocated from it has been destroyed). It also records the
+// peak number of bytes its frames have occupied, and handles frames which do not fit according to its overflow policy
+struct coroutine_stack : data_stack<coroutine_frame_data> {
+    // recorded past the end of a frame spilled to the heap, so that its block can be released
+    struct spilled_block {
+        void* block;
+        std::size_t align;
+    };
+
+    context_node* node_{nullptr};
+    std::size_t frame_count_{0};
+    std::size_t capacity_;
+
+    overflow_policy overflow_policy_{overflow_policy::terminate};
+    std::atomic_size_t high_water_mark_{0};
+    std::atomic_size_t overflow_count_{0};
+
+    // the peak usage of the coroutines spawned onto the stack since it was last handed out, if requested (see
+    // nano::stack_profile)
+    std::atomic_size_t* profile_{nullptr};
+
+    void overflow_(const std::size_t size);
+    void record_profile_(const std::size_t used) noexcept;
+    void record_high_water_mark_() noexcept;
+    [[nodiscard]] void* overflow_push_(const std::size_t size, const std::size_t align);
+
+    [[nodiscard]] void* push(const std::size_t size, const std::size_t align);
+    void pop();
+    void release_frame() noexcept;
+
+    // memory for a frame without a header of its own, which is resumed by its consumer rather than by the executor
+    [[nodiscard]] void* allocate(const std::size_t size, const std::size_t align);
+    void deallocate(void* ptr, const std::size_t size, const std::size_t align) noexcept;
+
+    [[nodiscard]] bool contains(const void* ptr) const noexcept {
+        const auto* byte_ptr = static_cast<const std::byte*>(ptr);
+        return byte_ptr >= end_ - capacity_ && byte_ptr < end_;
+    }
+
+    [[nodiscard]] std::size_t high_water_mark() const noexcept {
+        return high_water_mark_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::size_t overflow_count() const noexcept {
+        return overflow_count_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] view<coroutine_stack> view_of() noexcept { return view(*this); }
+
+    // binds a stack constructed without memory, as are those laid out apart from their buffers (see context_array)
+    void bind(std::byte* data, const std::size_t n) noexcept {
+        tail_ = data;
+        end_ = data + n;
+        space_ = n;
+        capacity_ = n;
+    }
+
+    coroutine_stack(std::byte* data, const std::size_t n) noexcept
+        : data_stack<coroutine_frame_data>(data, n), capacity_{n} {}
+
+    coroutine_stack() noexcept : coroutine_stack(nullptr, 0) {}
+};
+
 using coroutine_stack_view = view<coroutine_stack>;
 
-template <typename B>
-struct buffer_and_coroutine_stack {
+class spin_lock {
+   private:
+    std::atomic_flag flag_{};
+
+   public:
+    void lock() noexcept {
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            while (flag_.test(std::memory_order_relaxed)) {}
+        }
+    }
+
+    [[nodiscard]] bool try_lock() noexcept { return !flag_.test_and_set(std::memory_order_acquire); }
+    void unlock() noexcept { flag_.clear(std::memory_order_release); }
+};
+
+// an external source of completions (e.g. an io_uring) taking part in the steps and idle periods of a single-threaded
+// executor
+struct driver {
+    using time_point = std::chrono::steady_clock::time_point;
+
+    void* source_{nullptr};
+
+    // signals the coroutines whose requests completed, at the start of a step
+    void (*poll_)(void*) noexcept {nullptr};
+    // issues the requests made during a step, at its end
+    void (*flush_)(void*) noexcept {nullptr};
+    // blocks until a request completes, wake_ is called, or the deadline passes
+    void (*block_)(void*, std::optional<time_point>) noexcept {nullptr};
+    // may be called from any thread
+    void (*wake_)(void*) noexcept {nullptr};
+
+    [[nodiscard]] constexpr bool attached() const noexcept { return source_ != nullptr; }
+
+    void poll() const noexcept {
+        if (attached()) { poll_(source_); }
+    }
+
+    void flush() const noexcept {
+        if (attached()) { flush_(source_); }
+    }
+
+    template <typename D>
+    [[nodiscard]] static driver of(D& source) noexcept {
+        driver result{};
+        result.source_ = &source;
+        result.poll_ = [](void* ptr) noexcept { static_cast<D*>(ptr)->poll(); };
+        result.flush_ = [](void* ptr) noexcept { static_cast<D*>(ptr)->flush(); };
+        result.block_ = [](void* ptr, std::optional<time_point> deadline) noexcept {
+            static_cast<D*>(ptr)->block(deadline);
+        };
+        result.wake_ = [](void* ptr) noexcept { static_cast<D*>(ptr)->wake(); };
+        return result;
+    }
+};
+
+// lets idle threads sleep until another thread signals a context or, optionally, until a deadline passes. Waking is a
+// single load while nobody sleeps, so signalling stays cheap under load. With a driver attached, the sleeping thread
+// blocks in the driver instead so that its completions wake it too
+class parker {
+   private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::uint64_t epoch_{0};
+    std::atomic_uint32_t sleepers_{0};
+    driver driver_{};
+
+    void advance_epoch_() noexcept {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        ++epoch_;
+    }
+
+   public:
+    using time_point = driver::time_point;
+
+    void attach(const driver& source) noexcept { driver_ = source; }
+
+    // has_work is checked after announcing the sleeper, so work published before a call to unpark() is never missed
+    template <typename F>
+    void park(F&& has_work, const std::optional<time_point> deadline) noexcept {
+        if (driver_.attached()) {
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            if (!has_work()) { driver_.block_(driver_.source_, deadline); }
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+
+        const std::uint64_t epoch = epoch_;
+        const auto woken = [this, epoch] { return epoch_ != epoch; };
+
+        if (!has_work()) {
+            if (deadline.has_value()) {
+                condition_.wait_until(lock, *deadline, woken);
+            } else {
+                condition_.wait(lock, woken);
+            }
+        }
+
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void unpark() noexcept {
+        if (sleepers_.load(std::memory_order_seq_cst) == 0) { return; }
+
+        if (driver_.attached()) {
+            driver_.wake_(driver_.source_);
+            return;
+        }
+
+        advance_epoch_();
+        condition_.notify_one();
+    }
+
+    void unpark_all() noexcept {
+        if (driver_.attached()) {
+            driver_.wake_(driver_.source_);
+            return;
+        }
+
+        advance_epoch_();
+        condition_.notify_all();
+    }
+};
+
+// escalates from stepping to yielding to parking as consecutive steps find nothing to resume. A parked thread wakes by
+// the deadline, if any, at which the next timer may expire
+template <typename I>
+class backoff;
+
+template <>
+class backoff<idle::spin> {
+   public:
+    constexpr void reset() noexcept {}
+
+    template <typename F, typename G>
+    constexpr void idle(parker&, F&&, G&&) noexcept {}
+};
+
+template <std::size_t Spins, std::size_t Yields>
+class backoff<idle::adaptive<Spins, Yields>> {
+   private:
+    std::size_t idle_steps_{0};
+
+   public:
+    constexpr void reset() noexcept { idle_steps_ = 0; }
+
+    // deadline is only invoked once parking
+    template <typename F, typename G>
+    void idle(parker& waker, F&& has_work, G&& deadline) noexcept {
+        if (idle_steps_ < Spins) {
+            ++idle_steps_;
+            return;
+        }
+
+        if (idle_steps_ < Spins + Yields) {
+            ++idle_steps_;
+            std::this_thread::yield();
+            return;
+        }
+
+        waker.park(std::forward<F>(has_work), deadline());
+    }
+};
+
+class ready_queue;
+class context_pool;
+class timer_wheel;
+
+// the tracing state of a context, only present when its executor is traced
+struct context_trace {
+    std::size_t index_{0};
+    tracing::context_counters counters_{};
+
+    // the earliest time the context was signalled since it last ran, or zero
+    std::atomic<std::int64_t> woken_at_{0};
+
+    [[nodiscard]] static std::int64_t now() noexcept {
+        const auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+    }
+
+    void wake() noexcept {
+        std::int64_t expected = 0;
+        woken_at_.compare_exchange_strong(expected, now(), std::memory_order_relaxed);
+    }
+};
+
+struct context_node {
+    // a context is resumed by whoever moves it from queued to running, and signals which arrive while it is running
+    // are deferred until it is suspended again, so a context never runs on two threads at once
+    enum class run_state : std::uint8_t { idle, queued, running, notified };
+
+    static inline thread_local context_node* running_ = nullptr;
+
+    context_node* next_{nullptr};
+    std::atomic<run_state> state_{run_state::idle};
+
+    context_node* prev_idle_{nullptr};
+    context_node* next_idle_{nullptr};
+    bool idle_{false};
+    std::atomic_bool retiring_{false};
+
+    coroutine_stack* stack_;
+    ready_queue* queue_{nullptr};
+    context_pool* pool_{nullptr};
+    parker* parker_{nullptr};
+    timer_wheel* wheel_{nullptr};
+    context_trace* trace_{nullptr};
+
+    // set whenever a frame of the context is signalled, for executors which scan their contexts (rather than queueing
+    // them) to find ready ones without touching each context's stack
+    std::atomic_bool* pending_{nullptr};
+
+    [[nodiscard]] coroutine_stack& stack() const noexcept { return *stack_; }
+    [[nodiscard]] bool top_ready() const noexcept {
+        return !stack_->empty() && stack_->peek_frame_header().data().ready.load(std::memory_order_seq_cst);
+    }
+
+    [[nodiscard]] bool may_start_inline() const noexcept;
+
+    void schedule() noexcept;
+
+    // returns the context to its pool once its stack's memory is no longer in use, deferred until the node is no longer
+    // queued or running so that a stale run of the context can never overlap its next occupant being spawned
+    void retire() noexcept;
+    void release_if_retiring_() noexcept;
+
+    // resumes the top frame if it is ready, returning true when the context was signalled while running and must be
+    // pushed onto a queue again by the caller
+    [[nodiscard]] bool run() noexcept;
+
+    // resumes the top frame, which must be ready, marking the context as running on this thread meanwhile
+    void resume_top() noexcept;
+
+    // where a coroutine suspending on this context may transfer control: the top frame, when it is ready and the
+    // context is running on this thread (so nothing else may resume it), and otherwise back to the executor
+    [[nodiscard]] std::coroutine_handle<> transfer_target() const noexcept;
+
+    context_node& operator=(const context_node& other) = delete;
+    context_node(const context_node& other) = delete;
+
+    context_node(coroutine_stack& stack) noexcept : stack_{&stack} { stack.node_ = this; }
+};
+
+// intrusive list of contexts which may be reused alongside a count of the contexts with a non-empty stack
+class context_pool {
+   private:
+    context_node* idle_head_{nullptr};
+    std::atomic_size_t live_count_{0};
+
+    bool concurrent_;
+    spin_lock lock_;
+
+    [[nodiscard]] std::unique_lock<spin_lock> guard_() noexcept {
+        return concurrent_ ? std::unique_lock<spin_lock>(lock_) : std::unique_lock<spin_lock>();
+    }
+
+    void link_(context_node& node) noexcept {
+        node.prev_idle_ = nullptr;
+        node.next_idle_ = idle_head_;
+        node.idle_ = true;
+        if (idle_head_ != nullptr) { idle_head_->prev_idle_ = &node; }
+        idle_head_ = &node;
+    }
+
+    void unlink_(context_node& node) noexcept {
+        if (node.prev_idle_ != nullptr) { node.prev_idle_->next_idle_ = node.next_idle_; }
+        if (node.next_idle_ != nullptr) { node.next_idle_->prev_idle_ = node.prev_idle_; }
+        if (idle_head_ == &node) { idle_head_ = node.next_idle_; }
+
+        node.prev_idle_ = nullptr;
+        node.next_idle_ = nullptr;
+        node.idle_ = false;
+    }
+
+    void add_live_(const std::size_t delta) noexcept {
+        live_count_.store(live_count_.load(std::memory_order_relaxed) + delta, std::memory_order_release);
+    }
+
+   public:
+    [[nodiscard]] constexpr bool concurrent() const noexcept { return concurrent_; }
+    [[nodiscard]] std::size_t live_count() const noexcept { return live_count_.load(std::memory_order_acquire); }
+
+    // single-threaded use: the idle context stays in the pool until a coroutine is pushed onto its stack
+    [[nodiscard]] context_node* peek_idle() const noexcept { return idle_head_; }
+
+    // concurrent use: the idle context is removed from the pool so that no other thread can hand it out
+    [[nodiscard]] context_node* reserve_idle() noexcept {
+        const auto guard = guard_();
+        context_node* node = idle_head_;
+        if (node != nullptr) { unlink_(*node); }
+        return node;
+    }
+
+    void adopt(context_node& node) noexcept {
+        node.pool_ = this;
+        link_(node);
+    }
+
+    void acquire(context_node& node) noexcept {
+        const auto guard = guard_();
+        if (node.idle_) { unlink_(node); }
+    }
+
+    void release(context_node& node) noexcept {
+        const auto guard = guard_();
+        link_(node);
+    }
+
+    // calls f if the context is idle, during which it can't be handed out
+    template <typename F>
+    void if_idle(const context_node& node, F&& f) {
+        const auto guard = guard_();
+        if (node.idle_) { f(); }
+    }
+
+    void occupy() noexcept {
+        const auto guard = guard_();
+        add_live_(1);
+    }
+
+    void vacate() noexcept {
+        const auto guard = guard_();
+        add_live_(static_cast<std::size_t>(-1));
+    }
+
+    context_pool& operator=(const context_pool& other) = delete;
+    context_pool(const context_pool& other) = delete;
+
+    explicit context_pool(const bool concurrent = false) noexcept : concurrent_{concurrent} {}
+};
+
+// records a frame which did not fit in the profile with the size it needed, and only returns when the frame is to be
+// spilled to the heap
+inline void coroutine_stack::overflow_(const std::size_t size) {
+    record_profile_(capacity_ - space_ + size);
+    if (overflow_policy_ == overflow_policy::fail) { throw std::bad_alloc(); }
+
+    if (overflow_policy_ == overflow_policy::terminate) {
+        std::fprintf(stderr,
+                     "nano: coroutine stack overflow pushing a %zu-byte frame (%zu of %zu bytes in use, high-water "
+                     "mark %zu bytes)\n",
+                     size, capacity_ - space_, capacity_, high_water_mark());
+        std::abort();
+    }
+}
+
+inline void coroutine_stack::record_profile_(const std::size_t used) noexcept {
+    if (profile_ == nullptr) { return; }
+
+    std::size_t peak = profile_->load(std::memory_order_relaxed);
+    while (used > peak && !profile_->compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+}
+
+inline void coroutine_stack::record_high_water_mark_() noexcept {
+    const std::size_t used = capacity_ - space_;
+    if (used > high_water_mark()) { high_water_mark_.store(used, std::memory_order_relaxed); }
+    record_profile_(used);
+}
+
+// a spilled frame shares a heap block with its header, and records the block past its end
+inline void* coroutine_stack::overflow_push_(const std::size_t size, const std::size_t align) {
+    constexpr std::size_t header_size = sizeof(coroutine_stack_frame_header);
+    constexpr std::size_t header_align = std::alignment_of_v<coroutine_stack_frame_header>;
+
+    overflow_(header_size + size);
+
+    const std::size_t block_align = std::max(align, header_align);
+    const std::size_t frame_offset = (header_size + block_align - 1) / block_align * block_align;
+    void* block = ::operator new(frame_offset + size + sizeof(spilled_block), std::align_val_t{block_align});
+
+    std::byte* frame = static_cast<std::byte*>(block) + frame_offset;
+    const spilled_block record{block, block_align};
+    std::memcpy(frame + size, &record, sizeof(record));
+
+    push_external(block);
+    overflow_count_.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+inline void* coroutine_stack::push(const std::size_t size, const std::size_t align) {
+    void* frame = data_stack<coroutine_frame_data>::push(size, align);
+
+    if (frame == nullptr) {
+        frame = overflow_push_(size, align);
+    } else {
+        record_high_water_mark_();
+    }
+
+    context_pool* pool = node_ != nullptr ? node_->pool_ : nullptr;
+    if (pool != nullptr && frame_count_ == 0) { pool->acquire(*node_); }
+    if (pool != nullptr && current_frame_header_->ancestor_frame_header() == nullptr) { pool->occupy(); }
+
+    ++frame_count_;
+    return frame;
+}
+
+inline void coroutine_stack::pop() {
+    data_stack<coroutine_frame_data>::pop();
+    if (empty() && node_ != nullptr && node_->pool_ != nullptr) { node_->pool_->vacate(); }
+}
+
+inline void coroutine_stack::release_frame() noexcept {
+    --frame_count_;
+    if (frame_count_ == 0 && empty() && node_ != nullptr && node_->pool_ != nullptr) { node_->retire(); }
+}
+
+inline void* coroutine_stack::allocate(const std::size_t size, const std::size_t align) {
+    void* ptr = reserve_block(size, align);
+
+    if (ptr == nullptr) {
+        overflow_(size);
+        ptr = ::operator new(size, std::align_val_t{align});
+        overflow_count_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        record_high_water_mark_();
+    }
+
+    // holds the context like a frame would, but doesn't make it live: nothing here is for the executor to resume
+    context_pool* pool = node_ != nullptr ? node_->pool_ : nullptr;
+    if (pool != nullptr && frame_count_ == 0) { pool->acquire(*node_); }
+
+    ++frame_count_;
+    return ptr;
+}
+
+// the memory is reclaimed immediately when nothing above it is still in use, and otherwise once everything above it
+// has been released
+inline void coroutine_stack::deallocate(void* ptr, const std::size_t size, const std::size_t align) noexcept {
+    if (!contains(ptr)) {
+        ::operator delete(ptr, std::align_val_t{align});
+    } else {
+        release_block(ptr, size);
+    }
+
+    release_frame();
+}
+
+// a coroutine frame records the stack it was allocated from and its header just past its end, so that its memory is
+// only released for reuse by operator delete, once the frame's destruction has run to completion (rather than once it
+// is popped, as its promise may still be read)
+[[nodiscard]] inline void* allocate_frame(coroutine_stack& stack, const std::size_t size, const std::size_t align) {
+    void* frame = stack.push(size + sizeof(coroutine_stack*) + sizeof(coroutine_stack_frame_header*), align);
+    coroutine_stack* owner = &stack;
+    coroutine_stack_frame_header* header = &stack.peek_frame_header();
+    std::memcpy(static_cast<std::byte*>(frame) + size, &owner, sizeof(owner));
+    std::memcpy(static_cast<std::byte*>(frame) + size + sizeof(owner), &header, sizeof(header));
+    return frame;
+}
+
+inline void deallocate_frame(void* frame, const std::size_t size) noexcept {
+    coroutine_stack* owner;
+    coroutine_stack_frame_header* header;
+    std::memcpy(&owner, static_cast<std::byte*>(frame) + size, sizeof(owner));
+    std::memcpy(&header, static_cast<std::byte*>(frame) + size + sizeof(owner), sizeof(header));
+
+    if (owner->contains(frame)) {
+        owner->release(header->reservation_);
+    } else {
+        coroutine_stack::spilled_block record;
+        std::memcpy(&record, static_cast<std::byte*>(frame) + size + sizeof(owner) + sizeof(header), sizeof(record));
+        ::operator delete(record.block, std::align_val_t{record.align});
+    }
+
+    owner->release_frame();
+}
+
+// as above, for a frame which is resumed by the coroutine consuming it (see nano::generator)
+[[nodiscard]] inline void* allocate_detached_frame(coroutine_stack& stack, const std::size_t size,
+                                                   const std::size_t align) {
+    void* frame = stack.allocate(size + sizeof(coroutine_stack*), align);
+    coroutine_stack* owner = &stack;
+    std::memcpy(static_cast<std::byte*>(frame) + size, &owner, sizeof(owner));
+    return frame;
+}
+
+inline void deallocate_detached_frame(void* frame, const std::size_t size, const std::size_t align) noexcept {
+    coroutine_stack* owner;
+    std::memcpy(&owner, static_cast<std::byte*>(frame) + size, sizeof(owner));
+    owner->deallocate(frame, size + sizeof(owner), align);
+}
+
+// intrusive multi-producer queue of contexts with a ready frame: any number of threads may take_all() concurrently
+class ready_queue {
+   private:
+    std::atomic<context_node*> head_{nullptr};
+
+   public:
+    // sequentially consistent so that a thread about to park can't miss a push followed by parker::unpark()
+    [[nodiscard]] bool empty() const noexcept { return head_.load(std::memory_order_seq_cst) == nullptr; }
+
+    void push(context_node& node) noexcept {
+        context_node* head = head_.load(std::memory_order_relaxed);
+        do {
+            node.next_ = head;
+        } while (!head_.compare_exchange_weak(head, &node, std::memory_order_seq_cst, std::memory_order_relaxed));
+    }
+
+    // detaches every queued node at once, returning them as a list in the order they were pushed
+    [[nodiscard]] context_node* take_all() noexcept {
+        context_node* reversed = head_.exchange(nullptr, std::memory_order_acquire);
+        context_node* ordered = nullptr;
+
+        while (reversed != nullptr) {
+            context_node* next = reversed->next_;
+            reversed->next_ = ordered;
+            ordered = reversed;
+            reversed = next;
+        }
+
+        return ordered;
+    }
+};
+
+inline bool context_node::may_start_inline() const noexcept {
+    return pool_ == nullptr || !pool_->concurrent() || running_ == this;
+}
+
+inline void context_node::schedule() noexcept {
+    if (queue_ == nullptr) {
+        // signalled from a frame of the same executor running on this thread, which can't be parked and observes the
+        // flag at its next pass in program order
+        if (running_ != nullptr && running_->parker_ == parker_) {
+            if (pending_ != nullptr) { pending_->store(true, std::memory_order_relaxed); }
+            return;
+        }
+
+        if (pending_ != nullptr) { pending_->store(true, std::memory_order_seq_cst); }
+        if (parker_ != nullptr) { parker_->unpark(); }
+        return;
+    }
+
+    run_state state = state_.load(std::memory_order_seq_cst);
+    for (;;) {
+        if (state == run_state::queued || state == run_state::notified) { return; }
+
+        const run_state desired = state == run_state::idle ? run_state::queued : run_state::notified;
+        if (state_.compare_exchange_weak(state, desired, std::memory_order_seq_cst)) {
+            if (desired == run_state::queued) {
+                queue_->push(*this);
+                if (parker_ != nullptr) { parker_->unpark(); }
+            }
+
+            return;
+        }
+    }
+}
+
+inline void context_node::retire() noexcept {
+    retiring_.store(true, std::memory_order_seq_cst);
+    if (state_.load(std::memory_order_seq_cst) == run_state::idle) { release_if_retiring_(); }
+}
+
+inline void context_node::release_if_retiring_() noexcept {
+    if (retiring_.exchange(false, std::memory_order_seq_cst)) { pool_->release(*this); }
+}
+
+inline bool context_node::run() noexcept {
+    state_.store(run_state::running, std::memory_order_seq_cst);
+
+    if (top_ready()) { resume_top(); }
+
+    run_state expected = run_state::running;
+    if (state_.compare_exchange_strong(expected, run_state::idle, std::memory_order_seq_cst)) {
+        if (pool_ != nullptr) { release_if_retiring_(); }
+        return false;
+    }
+
+    state_.store(run_state::queued, std::memory_order_seq_cst);
+    return true;
+}
+
+inline void context_node::resume_top() noexcept {
+    context_node* const previous = std::exchange(running_, this);
+    stack_->peek_frame_header().data().handle.resume();
+    running_ = previous;
+}
+
+inline std::coroutine_handle<> context_node::transfer_target() const noexcept {
+    if (running_ != this || !top_ready()) { return std::noop_coroutine(); }
+    return stack_->peek_frame_header().data().handle;
+}
+
+// sets a receiver once a given number of signals have been set, so that a coroutine waiting on several others is
+// signalled exactly once. Signals set beyond the count are ignored
+class countdown {
+   private:
+    std::atomic<std::int64_t> remaining_;
+    signal receiver_;
+    std::atomic_bool unused_state_{false};
+
+   public:
+    // true for the arrival which completes the countdown. Every other arrival must not access the countdown afterwards,
+    // as its owner may destroy it as soon as the receiver is set
+    [[nodiscard]] bool arrive() noexcept { return remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    [[nodiscard]] signal receiver() const noexcept { return receiver_; }
+    [[nodiscard]] signal arrival_signal() noexcept { return signal(unused_state_, this); }
+
+    countdown& operator=(const countdown& other) = delete;
+    countdown(const countdown& other) = delete;
+
+    countdown(const std::int64_t count, signal receiver) noexcept : remaining_{count}, receiver_{receiver} {}
+};
+
+inline void signal::set(const bool value) const noexcept {
+    if (countdown_ != nullptr) {
+        // copied first, as the receiver may destroy the countdown once set
+        if (value && countdown_->arrive()) {
+            const signal receiver = countdown_->receiver();
+            receiver.set(true);
+        }
+        return;
+    }
+
+    state_->store(value, std::memory_order_seq_cst);
+    if (value && node_ != nullptr) {
+        if constexpr (tracing::hooks_v) {
+            if (node_->trace_ != nullptr) { node_->trace_->wake(); }
+        }
+
+        node_->schedule();
+    }
+}
+
+// the receiver cleared ahead of attaching it to producers, as one completing on another thread may set it as soon as
+// it is attached (clearing it afterwards would lose that wake-up)
+[[nodiscard]] inline signal cleared(const signal receiver_signal) noexcept {
+    receiver_signal.set(false);
+    return receiver_signal;
+}
+
+// hands a single receiver's signal to a producer which completes at most once, possibly on another thread
+class completion_signal {
+   private:
+    enum class state : std::uint8_t { pending, attached, complete };
+
+    std::atomic<state> state_{state::pending};
+    signal receiver_{signal::make_detached()};
+    std::atomic_bool* delivered_{nullptr};
+
+   public:
+    [[nodiscard]] bool complete() const noexcept { return state_.load(std::memory_order_acquire) == state::complete; }
+
+    // returns true, without attaching, when already complete. Otherwise, the receiver is set once complete, after which
+    // delivered (if provided) is set, so a receiver which fails to detach knows when no further access will be made
+    [[nodiscard]] bool attach(signal receiver, std::atomic_bool* delivered = nullptr) noexcept {
+        state current = state_.load(std::memory_order_acquire);
+
+        for (;;) {
+            if (current == state::complete) { return true; }
+
+            if (current == state::attached) {
+                if (state_.compare_exchange_weak(current, state::pending, std::memory_order_acq_rel)) {
+                    current = state::pending;
+                }
+
+                continue;
+            }
+
+            receiver_ = receiver;
+            delivered_ = delivered;
+            receiver.set(false);
+
+            if (state_.compare_exchange_strong(current, state::attached, std::memory_order_acq_rel)) { return false; }
+        }
+    }
+
+    // returns false when completion won the race, in which case the receiver is (or is about to be) set
+    [[nodiscard]] bool detach() noexcept {
+        state expected = state::attached;
+        return state_.compare_exchange_strong(expected, state::pending, std::memory_order_acq_rel);
+    }
+
+    // the completion_signal may be destroyed by the receiver as soon as this is called. Returns whether the receiver
+    // was signalled, i.e. whether one had attached (and so was suspended) beforehand
+    bool notify() noexcept {
+        if (state_.exchange(state::complete, std::memory_order_acq_rel) != state::attached) { return false; }
+
+        const signal receiver = receiver_;
+        std::atomic_bool* const delivered = delivered_;
+
+        receiver.set(true);
+        if (delivered != nullptr) { delivered->store(true, std::memory_order_release); }
+        return true;
+    }
+};
+
+// starts a coroutine inline, unless that would let it run concurrently with the thread owning its context. Otherwise,
+// its frame is only signalled ready once suspended so that no other thread may resume it beforehand
+class start_awaiter {
+   private:
+    bool start_inline_;
+    signal ready_signal_;
+
+   public:
+    [[nodiscard]] constexpr bool await_ready() const noexcept { return start_inline_; }
+    void await_suspend(std::coroutine_handle<>) const noexcept { ready_signal_.set(true); }
+    constexpr void await_resume() const noexcept {}
+
+    start_awaiter(const bool start_inline, signal ready_signal) noexcept
+        : start_inline_{start_inline}, ready_signal_{ready_signal} {
+        if (start_inline_) { ready_signal_.set(true); }
+    }
+};
+
+// an executor's N contexts laid out as a structure of arrays: the pending flags scanned every step are packed together,
+// followed by the stacks' and nodes' metadata and only then by the (typically large) buffers, so that a scheduling pass
+// reads a few contiguous cache lines rather than one line per context spread across the buffers
+template <typename B, std::size_t N>
+class context_array {
+   private:
+    struct context {
+        coroutine_stack stack_{};
+        context_node node_{stack_};
+    };
+
+    alignas(64) std::array<std::atomic_bool, N> pending_{};
+    alignas(64) std::array<context, N> contexts_{};
+    std::array<B, N> buffers_{};
+
+   public:
     using buffer_type = B;
-    B buffer_;
-    coroutine_stack stack_;
 
-    [[nodiscard]] coroutine_stack_view stack_view() noexcept { return stack_.view_of(); }
-    [[nodiscard]] coroutine_stack& stack() noexcept { return stack_; }
-    [[nodiscard]] const coroutine_stack& stack() const noexcept { return stack_; }
+    [[nodiscard]] static constexpr std::size_t size() noexcept { return N; }
+
+    [[nodiscard]] B& buffer(const std::size_t index) noexcept { return buffers_[index]; }
+    [[nodiscard]] coroutine_stack& stack(const std::size_t index) noexcept { return contexts_[index].stack_; }
+    [[nodiscard]] const coroutine_stack& stack(const std::size_t index) const noexcept {
+        return contexts_[index].stack_;
+    }
 
-    buffer_and_coroutine_stack() noexcept : buffer_{}, stack_(buffer_.data(), buffer_.size()) {}
+    [[nodiscard]] context_node& node(const std::size_t index) noexcept { return contexts_[index].node_; }
+    [[nodiscard]] std::atomic_bool& pending(const std::size_t index) noexcept { return pending_[index]; }
+    [[nodiscard]] const std::atomic_bool& pending(const std::size_t index) const noexcept { return pending_[index]; }
+
+    context_array& operator=(const context_array& other) = delete;
+    context_array(const context_array& other) = delete;
+
+    context_array() noexcept {
+        for (std::size_t index = 0; index < N; ++index) {
+            contexts_[index].stack_.bind(buffers_[index].data(), buffers_[index].size());
+        }
+    }
 };
 
 }  // namespace detail
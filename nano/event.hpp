@@ -19,42 +19,47 @@
 
 #include <nano/detail.hpp>
 
+#include <atomic>
 #include <coroutine>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace nano {
 
+// a single value sent once, possibly from another thread, to the coroutine awaiting it
 template <typename T>
 class event {
    private:
-    detail::signal receiver_signal_{detail::signal::make_detached()};
+    detail::completion_signal completion_{};
     std::optional<T> result_{std::nullopt};
 
    public:
     class awaiter_type {
        private:
-        detail::optional_view<T> result_;
+        detail::view<event<T>> event_;
+        bool ready_;
 
        public:
-        [[nodiscard]] constexpr bool await_ready() const noexcept { return result_.get().has_value(); }
-        [[nodiscard]] constexpr T await_resume() const noexcept { return result_.get().value(); }
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+        [[nodiscard]] bool detach() noexcept { return event_.get().completion_.detach(); }
+        [[nodiscard]] constexpr T await_resume() const noexcept { return event_.get().result_.value(); }
         constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
 
-        awaiter_type(detail::optional_view<T> result_view) noexcept : result_{result_view} {}
+        awaiter_type(detail::view<event<T>> event_view, const bool ready) noexcept
+            : event_{event_view}, ready_{ready} {}
     };
 
+    // the value is published by the completion handshake, so the receiver never observes a partially stored value
     template <typename U, std::enable_if_t<std::is_same_v<std::decay_t<U>, T>, T>* = nullptr>
     constexpr void send(U&& value) noexcept {
-        receiver_signal_.set(true);
-        result_ = std::move(value);
+        result_ = std::forward<U>(value);
+        completion_.notify();
     }
 
-    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) {
-        receiver_signal.set(result_.has_value());
-        receiver_signal_ = receiver_signal;
-
-        auto result_view = detail::view(result_);
-        return awaiter_type{result_view};
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        const bool ready = completion_.attach(receiver_signal, delivered);
+        return awaiter_type{detail::view(*this), ready};
     }
 
     event(const event<T>& other) = delete;
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <coroutine>
+#include <type_traits>
 
 namespace nano {
 
@@ -39,6 +40,9 @@ struct await_expression<lazy> {
     using type = std::suspend_always;
 };
 
+template <typename T>
+inline constexpr bool is_eager_v = std::is_same_v<T, eager>;
+
 }  // namespace execution
 
 }  // namespace nano
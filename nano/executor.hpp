@@ -20,52 +20,456 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <nano/cancellation.hpp>
 #include <nano/detail.hpp>
+#include <nano/idle.hpp>
+#include <nano/memory_resource.hpp>
+#include <nano/overflow.hpp>
+#include <nano/scheduling.hpp>
+#include <nano/timer.hpp>
+#include <nano/tracing.hpp>
+#include <optional>
+#include <ostream>
+#include <type_traits>
+#include <vector>
 
 namespace nano {
 
 struct coroutine_context {
     detail::coroutine_stack_view stack;
+    detail::context_node* node{nullptr};
+    cancellation_token token{};
+
+    // the same context, its coroutines observing the token at every co_await (and passing it on to those spawned
+    // with this context)
+    [[nodiscard]] constexpr coroutine_context with_cancellation(const cancellation_token cancellation) const noexcept {
+        return coroutine_context{stack, node, cancellation};
+    }
+
+    // scratch memory for the coroutine running on the context, released once it completes (see stack_memory_resource)
+    [[nodiscard]] stack_memory_resource memory_resource(
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept {
+        return stack_memory_resource(stack.get(), upstream);
+    }
+};
+
+namespace detail {
+
+// times the resumes of an executor's contexts, compiling away entirely for tracing::none
+template <typename T, std::size_t N>
+class tracer {
+   public:
+    constexpr void adopt(context_node&, const std::size_t) noexcept {}
+    constexpr void end_step(const std::size_t) noexcept {}
+
+    template <typename F>
+    constexpr void resume(context_node&, F&& f) noexcept {
+        f();
+    }
 };
 
-template <typename B, std::size_t N>
+template <std::size_t Spans, std::size_t N>
+class tracer<tracing::enabled<Spans>, N> {
+   private:
+    std::array<context_trace, N> traces_{};
+    tracing::step_counters steps_{};
+
+    // the most recent Spans resumes, overwritten oldest first
+    std::vector<tracing::span> spans_;
+    std::uint64_t span_count_{0};
+    std::int64_t epoch_{context_trace::now()};
+
+    static void write_microseconds_(std::ostream& out, const std::chrono::nanoseconds duration) {
+        char text[32];
+        const long long count = duration.count();
+        std::snprintf(text, sizeof(text), "%lld.%03lld", count / 1000, count % 1000);
+        out << text;
+    }
+
+   public:
+    [[nodiscard]] const tracing::context_counters& counters(const std::size_t index) const noexcept {
+        return traces_[index].counters_;
+    }
+
+    [[nodiscard]] const tracing::step_counters& steps() const noexcept { return steps_; }
+
+    void adopt(context_node& node, const std::size_t index) noexcept {
+        traces_[index].index_ = index;
+        node.trace_ = &traces_[index];
+    }
+
+    void end_step(const std::size_t resumes) noexcept {
+        ++steps_.steps;
+        steps_.resumes += resumes;
+        steps_.max_resumes_per_step = std::max<std::uint64_t>(steps_.max_resumes_per_step, resumes);
+        if (resumes == 0) { ++steps_.idle_steps; }
+    }
+
+    // signals arriving while the context runs are attributed to its next resume. A context queued more than once
+    // before running (whose top frame is no longer ready) is not resumed, so isn't recorded
+    template <typename F>
+    void resume(context_node& node, F&& f) noexcept {
+        if (!node.top_ready()) {
+            f();
+            return;
+        }
+
+        context_trace& trace = *node.trace_;
+        const std::int64_t woken_at = trace.woken_at_.exchange(0, std::memory_order_relaxed);
+
+        const std::int64_t start = context_trace::now();
+        f();
+        const std::int64_t end = context_trace::now();
+
+        tracing::context_counters& counters = trace.counters_;
+        const std::chrono::nanoseconds run_time{end - start};
+        const std::chrono::nanoseconds wake_latency{woken_at != 0 ? start - woken_at : 0};
+
+        ++counters.resumes;
+        counters.run_time += run_time;
+        counters.max_run_time = std::max(counters.max_run_time, run_time);
+        counters.run_times.record(run_time);
+        if (woken_at != 0) { counters.wake_latencies.record(wake_latency); }
+
+        const std::chrono::nanoseconds since_epoch{start - epoch_};
+        spans_[span_count_++ % Spans] = tracing::span{trace.index_, since_epoch, since_epoch + run_time, wake_latency};
+    }
+
+    // writes the recorded spans in the Chrome trace event format, one track per context
+    void write_chrome_trace(std::ostream& out) const {
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        bool first = true;
+        for (const context_trace& trace : traces_) {
+            if (trace.counters_.resumes == 0) { continue; }
+
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << trace.index_
+                << ",\"args\":{\"name\":\"context " << trace.index_ << "\"}}";
+            first = false;
+        }
+
+        const std::uint64_t oldest = span_count_ > Spans ? span_count_ - Spans : 0;
+        for (std::uint64_t index = oldest; index < span_count_; ++index) {
+            const tracing::span& span = spans_[index % Spans];
+
+            out << (first ? "" : ",") << "\n{\"name\":\"resume\",\"ph\":\"X\",\"pid\":0,\"tid\":" << span.context
+                << ",\"ts\":";
+            write_microseconds_(out, span.start);
+            out << ",\"dur\":";
+            write_microseconds_(out, span.end - span.start);
+            out << ",\"args\":{\"wake_latency_us\":";
+            write_microseconds_(out, span.wake_latency);
+            out << "}}";
+            first = false;
+        }
+
+        out << "\n]}\n";
+    }
+
+    tracer() : spans_(Spans) {}
+};
+
+// the scheduling loop shared by the executors. Each step signals expired timers, polls the driver and then resumes the
+// ready contexts of C (exposing size(), pending(index) and node(index)) according to S, wait() idling according to I
+// between steps. Contexts are wired to it with adopt()
+template <typename S, typename I, typename T, std::size_t N>
+class scheduler {
+   private:
+    static constexpr bool is_queued = scheduling::is_queued_v<S>;
+    static constexpr std::size_t class_count = scheduling::class_count_v<S>;
+    static constexpr std::size_t aging_steps = scheduling::aging_steps_v<S>;
+
+    std::array<ready_queue, class_count> ready_queues_;
+    std::array<std::size_t, class_count> passed_over_{};
+    parker parker_;
+    timer_wheel wheel_;
+    driver driver_{};
+    [[no_unique_address]] tracer<T, N> tracer_{};
+
+    template <typename C>
+    constexpr std::size_t poll_step_(C& contexts) noexcept {
+        std::size_t resumed = 0;
+
+        for (std::size_t index = 0; index < contexts.size(); ++index) {
+            // the flags of idle contexts are only read, so that their lines stay shared
+            std::atomic_bool& pending = contexts.pending(index);
+            if (!pending.load(std::memory_order_relaxed)) { continue; }
+
+            // the flag of a ready top frame is cleared without a fence, as a signal from another thread only follows
+            // the frame publishing its receiver once resumed. Otherwise the signal was to a frame beneath the top
+            // (resumed directly once the top completes) or stale, unless the top became ready meanwhile
+            context_node& node = contexts.node(index);
+            if (node.top_ready()) {
+                pending.store(false, std::memory_order_relaxed);
+            } else if (!pending.exchange(false, std::memory_order_seq_cst) || !node.top_ready()) {
+                continue;
+            }
+
+            tracer_.resume(node, [&node] { node.resume_top(); });
+            ++resumed;
+        }
+
+        return resumed;
+    }
+
+    constexpr std::size_t run_queue_(ready_queue& queue) noexcept {
+        // contexts signalled while this step runs are deferred to the next step
+        context_node* node = queue.take_all();
+        std::size_t resumed = 0;
+
+        while (node != nullptr) {
+            context_node* next = node->next_;
+
+            bool signalled = false;
+            tracer_.resume(*node, [node, &signalled] { signalled = node->run(); });
+            if (signalled) { queue.push(*node); }
+
+            node = next;
+            ++resumed;
+        }
+
+        return resumed;
+    }
+
+    // the most urgent class with a ready context is run, along with any other class passed over for aging_steps steps
+    constexpr std::size_t queued_step_() noexcept {
+        std::size_t resumed = 0;
+        bool ran = false;
+
+        for (std::size_t priority = 0; priority < class_count; ++priority) {
+            ready_queue& queue = ready_queues_[priority];
+            if (queue.empty()) {
+                passed_over_[priority] = 0;
+                continue;
+            }
+
+            if (ran && ++passed_over_[priority] < aging_steps) { continue; }
+
+            passed_over_[priority] = 0;
+            resumed += run_queue_(queue);
+            ran = true;
+        }
+
+        return resumed;
+    }
+
+   public:
+    [[nodiscard]] const tracer<T, N>& traces() const noexcept { return tracer_; }
+
+    // the queue of the given priority class, priorities past the least urgent class falling into it
+    [[nodiscard]] ready_queue& queue(const std::size_t priority) noexcept {
+        return ready_queues_[std::min(priority, class_count - 1)];
+    }
+
+    // returns whether any frame was resumed. Expired timers are signalled first so that their coroutines resume within
+    // the same step
+    template <typename C>
+    constexpr bool step(C& contexts) noexcept {
+        wheel_.advance(clock::now());
+        driver_.poll();
+
+        std::size_t resumed = 0;
+        if constexpr (is_queued) {
+            resumed = queued_step_();
+        } else {
+            resumed = poll_step_(contexts);
+        }
+
+        driver_.flush();
+        wheel_.end_step();
+        tracer_.end_step(resumed);
+        return resumed != 0;
+    }
+
+    template <typename C>
+    [[nodiscard]] bool has_ready_context(const C& contexts) const noexcept {
+        if constexpr (is_queued) {
+            return std::any_of(ready_queues_.begin(), ready_queues_.end(),
+                               [](const ready_queue& queue) { return !queue.empty(); });
+        } else {
+            for (std::size_t index = 0; index < contexts.size(); ++index) {
+                if (contexts.pending(index).load(std::memory_order_seq_cst)) { return true; }
+            }
+
+            return false;
+        }
+    }
+
+    // steps until complete() holds and no context is ready, idling according to I while nothing was resumed
+    template <typename C, typename F>
+    constexpr void wait(C& contexts, F&& complete) noexcept {
+        backoff<I> backoff{};
+
+        for (;;) {
+            // contexts still queued by signals which arrived as their last frame completed are run once more, so
+            // that they may be handed out again as soon as their coroutines are destroyed
+            if (complete() && !has_ready_context(contexts)) { return; }
+
+            if (step(contexts)) {
+                backoff.reset();
+            } else {
+                backoff.idle(
+                    parker_, [this, &contexts] { return has_ready_context(contexts); },
+                    [this] { return wheel_.next_expiry(); });
+            }
+        }
+    }
+
+    template <typename D>
+    void attach(D& source) noexcept {
+        driver_ = driver::of(source);
+        parker_.attach(driver_);
+    }
+
+    // signals to the index-th context's frames reach this scheduler, through its pending flag or the most urgent queue
+    void adopt(context_node& node, std::atomic_bool& pending, const std::size_t index) noexcept {
+        node.parker_ = &parker_;
+        node.wheel_ = &wheel_;
+        tracer_.adopt(node, index);
+
+        if constexpr (is_queued) {
+            node.queue_ = &ready_queues_[0];
+        } else {
+            node.pending_ = &pending;
+        }
+    }
+};
+
+}  // namespace detail
+
+// S selects how ready contexts are found each step, I how the executor idles in wait(), O how a frame which does not
+// fit in its context's stack is handled and T whether resumes are traced
+template <typename B, std::size_t N, typename S = scheduling::poll, typename I = idle::adaptive<>,
+          typename O = overflow::terminate, typename T = tracing::none>
 class executor {
    private:
+    static_assert(!tracing::is_enabled_v<T> || tracing::hooks_v,
+                  "tracing::enabled requires NANO_TRACING to be defined before including nano");
+
     static constexpr std::size_t context_stack_count = N;
     using buffer_type = B;
 
-    std::array<detail::buffer_and_coroutine_stack<B>, N> stacks_;
+    detail::context_array<B, N> contexts_;
+    detail::context_pool pool_;
+    detail::scheduler<S, I, T, N> scheduler_;
 
-    [[nodiscard]] constexpr bool execution_complete_() const noexcept {
-        return std::all_of(stacks_.begin(), stacks_.end(), [](const auto& elem) { return elem.stack().empty(); });
-    }
+    [[nodiscard]] constexpr bool execution_complete_() const noexcept { return pool_.live_count() == 0; }
 
-    constexpr void step_() noexcept {
-        for (const auto& elem : stacks_) {
-            const auto& stack = elem.stack();
-            if (stack.empty() || !stack.peek_frame_header().data().ready.load(std::memory_order_relaxed)) { continue; }
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context_(const std::size_t priority) noexcept {
+        detail::context_node* node = pool_.peek_idle();
+        if (node == nullptr) { return std::nullopt; }
 
-            stack.peek_frame_header().data().handle.resume();
-        }
+        if constexpr (scheduling::is_queued_v<S>) { node->queue_ = &scheduler_.queue(priority); }
+        return coroutine_context{node->stack().view_of(), node};
     }
 
    public:
-    [[nodiscard]] coroutine_context find_available_context() noexcept {
-        const auto iter =
-            std::find_if(stacks_.begin(), stacks_.end(), [](const auto& elem) { return elem.stack().empty(); });
+    // the returned context stays available until a coroutine is spawned onto it
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context() noexcept {
+        return try_find_available_context_(0);
+    }
+
+    // as above, with the context's frames resumed according to priority (0 being the most urgent, and priorities past
+    // the least urgent class falling into it)
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context(const std::size_t priority) noexcept
+        requires scheduling::is_prioritized_v<S>
+    {
+        return try_find_available_context_(priority);
+    }
+
+    // terminates if every context is occupied
+    [[nodiscard]] coroutine_context find_available_context() noexcept { return try_find_available_context().value(); }
 
-        return coroutine_context{iter->stack_view()};
+    [[nodiscard]] coroutine_context find_available_context(const std::size_t priority) noexcept
+        requires scheduling::is_prioritized_v<S>
+    {
+        return try_find_available_context(priority).value();
     }
 
+    [[nodiscard]] constexpr std::size_t live_context_count() const noexcept { return pool_.live_count(); }
+    [[nodiscard]] constexpr std::size_t capacity() const noexcept { return context_stack_count; }
+
     [[nodiscard]] constexpr bool execution_complete() const noexcept { return execution_complete_(); }
 
-    constexpr void step() noexcept { step_(); }
+    // the peak number of bytes occupied by the frames of the index-th context, for sizing B tightly
+    [[nodiscard]] std::size_t stack_high_water_mark(const std::size_t index) const noexcept {
+        return contexts_.stack(index).high_water_mark();
+    }
+
+    // the peak number of bytes occupied by the frames of any context
+    [[nodiscard]] std::size_t stack_high_water_mark() const noexcept {
+        std::size_t high_water_mark = 0;
+        for (std::size_t index = 0; index < context_stack_count; ++index) {
+            high_water_mark = std::max(high_water_mark, contexts_.stack(index).high_water_mark());
+        }
+
+        return high_water_mark;
+    }
+
+    // the number of frames which did not fit in their context's stack and were spilled to the heap
+    [[nodiscard]] std::size_t stack_overflow_count() const noexcept {
+        std::size_t overflow_count = 0;
+        for (std::size_t index = 0; index < context_stack_count; ++index) {
+            overflow_count += contexts_.stack(index).overflow_count();
+        }
+
+        return overflow_count;
+    }
 
+    // how often and for how long the index-th context ran, and how long it waited to be resumed once signalled
+    [[nodiscard]] const tracing::context_counters& context_counters(const std::size_t index) const noexcept
+        requires tracing::is_enabled_v<T>
+    {
+        return scheduler_.traces().counters(index);
+    }
+
+    [[nodiscard]] const tracing::step_counters& step_counters() const noexcept
+        requires tracing::is_enabled_v<T>
+    {
+        return scheduler_.traces().steps();
+    }
+
+    // loadable in Perfetto or chrome://tracing
+    void write_chrome_trace(std::ostream& out) const
+        requires tracing::is_enabled_v<T>
+    {
+        scheduler_.traces().write_chrome_trace(out);
+    }
+
+    // returns the memory of idle contexts' stacks to the OS (e.g. after a long idle period) for buffers supporting it,
+    // such as nano::mmap_buffer
+    void decommit_idle_stacks() noexcept {
+        if constexpr (requires(B& buffer) { buffer.decommit(); }) {
+            for (std::size_t index = 0; index < context_stack_count; ++index) {
+                pool_.if_idle(contexts_.node(index), [this, index] { contexts_.buffer(index).decommit(); });
+            }
+        }
+    }
+
+    constexpr void step() noexcept { static_cast<void>(scheduler_.step(contexts_)); }
+
+    // polls D (e.g. a nano::io::ring) for completions every step, and blocks in it rather than parking when idle
+    template <typename D>
+    void attach(D& source) noexcept {
+        scheduler_.attach(source);
+    }
+
+    // idles according to I while every live coroutine is waiting, e.g. on an event sent from another thread
     constexpr void wait() noexcept {
-        for (;;) {
-            if (execution_complete_()) { return; }
-            step_();
+        scheduler_.wait(contexts_, [this] { return execution_complete_(); });
+    }
+
+    executor() noexcept {
+        // adopted in reverse so that contexts are handed out in index order
+        for (std::size_t index = context_stack_count; index-- > 0;) {
+            detail::context_node& node = contexts_.node(index);
+            pool_.adopt(node);
+            contexts_.stack(index).overflow_policy_ = detail::overflow_policy_v<O>;
+            scheduler_.adopt(node, contexts_.pending(index), index);
         }
     }
 };
@@ -0,0 +1,396 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/detail.hpp>
+#include <nano/event.hpp>
+#include <nano/executor.hpp>
+#include <nano/task.hpp>
+#include <nano/yield.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace nano {
+
+namespace detail {
+
+inline constexpr std::size_t shard_message_capacity = 64;
+
+// the group and shard the calling thread runs, if any
+inline thread_local const void* current_shard_group = nullptr;
+inline thread_local std::size_t current_shard_index = 0;
+
+// bounded single-producer single-consumer ring of N messages for a shard S. Each message is a function object
+// constructed in place in its slot and run there by the consumer, which stops at the first one unable to run yet (e.g.
+// as no context is free) to retry it at its next step
+template <typename S, std::size_t N>
+class shard_ring {
+   private:
+    static_assert(N > 0);
+
+    struct slot {
+        bool (*run_)(void*, S&) noexcept {nullptr};
+        void (*destroy_)(void*) noexcept {nullptr};
+        alignas(std::max_align_t) std::byte storage[shard_message_capacity];
+    };
+
+    alignas(64) std::atomic_size_t tail_{0};
+    alignas(64) std::atomic_size_t head_{0};
+    std::array<slot, N> slots_;
+
+   public:
+    // sequentially consistent so that a consumer about to sleep can't miss a message published before its check
+    template <typename F>
+    [[nodiscard]] bool try_push(F&& function) {
+        using function_type = std::decay_t<F>;
+        static_assert(sizeof(function_type) <= shard_message_capacity);
+        static_assert(alignof(function_type) <= alignof(std::max_align_t));
+
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == N) { return false; }
+
+        slot& target = slots_[tail % N];
+        ::new (static_cast<void*>(target.storage)) function_type(std::forward<F>(function));
+        target.run_ = [](void* ptr, S& shard) noexcept -> bool { return (*static_cast<function_type*>(ptr))(shard); };
+        target.destroy_ = [](void* ptr) noexcept { std::destroy_at(static_cast<function_type*>(ptr)); };
+
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // consumer only
+    [[nodiscard]] bool empty() const noexcept {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_seq_cst);
+    }
+
+    // consumer only. Returns false when a message was left to retry
+    [[nodiscard]] bool run(S& shard) noexcept {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            slot& source = slots_[head % N];
+            if (!source.run_(source.storage, shard)) { return false; }
+
+            source.destroy_(source.storage);
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        return true;
+    }
+
+    shard_ring& operator=(const shard_ring& other) = delete;
+    shard_ring(const shard_ring& other) = delete;
+
+    shard_ring() = default;
+
+    ~shard_ring() noexcept {
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        for (std::size_t head = head_.load(std::memory_order_relaxed); head != tail; ++head) {
+            slot& source = slots_[head % N];
+            source.destroy_(source.storage);
+        }
+    }
+};
+
+// one executor X of a group of Shards, with a ring from each other shard (and from the thread owning the group, last)
+// of Q messages. It is attached to its executor as a driver, so that its rings are drained at every step and so that it
+// sleeps until either a message or a signal from another thread arrives
+template <typename X, std::size_t Shards, std::size_t Q>
+class executor_shard {
+   private:
+    using time_point = driver::time_point;
+
+    X executor_{};
+    task_group<X> tasks_{executor_};
+    std::array<shard_ring<executor_shard, Q>, Shards + 1> inbound_{};
+    std::array<std::unique_ptr<executor_shard>, Shards>* peers_;
+
+    // the number of spawns posted across the group but not yet finished, so that no shard stops while another may
+    // still post to it
+    std::atomic_size_t* outstanding_;
+    std::atomic_bool* stopping_;
+
+    std::mutex mutex_{};
+    std::condition_variable condition_{};
+    bool woken_{false};
+    std::atomic_bool sleeping_{false};
+    bool stalled_{false};
+
+    [[nodiscard]] bool has_message_() const noexcept {
+        for (const auto& ring : inbound_) {
+            if (!ring.empty()) { return true; }
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] bool finished_() const noexcept {
+        return stopping_->load(std::memory_order_seq_cst) && outstanding_->load(std::memory_order_seq_cst) == 0;
+    }
+
+    // once stopping, the last outstanding spawn finishing lets every shard stop
+    void finish_(const std::size_t reclaimed) noexcept {
+        if (reclaimed == 0 || outstanding_->fetch_sub(reclaimed, std::memory_order_seq_cst) != reclaimed) { return; }
+        if (!stopping_->load(std::memory_order_seq_cst)) { return; }
+
+        for (auto& peer : *peers_) { peer->wake(); }
+    }
+
+    template <typename P>
+    void sleep_(const std::optional<time_point> deadline, P&& awake) noexcept {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_seq_cst);
+
+        const auto woken = [this, &awake] { return woken_ || awake(); };
+        if (deadline.has_value()) {
+            condition_.wait_until(lock, *deadline, woken);
+        } else {
+            condition_.wait(lock, woken);
+        }
+
+        woken_ = false;
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+   public:
+    [[nodiscard]] shard_ring<executor_shard, Q>& inbound(const std::size_t sender) noexcept { return inbound_[sender]; }
+
+    // runs a posted spawn, or returns false to retry it at the next step when no context is free
+    template <typename F, typename... Args>
+    [[nodiscard]] bool try_spawn(F& function, Args&... args) {
+        return tasks_.try_spawn(function, args...);
+    }
+
+    // the finished spawns are reclaimed first, so that their contexts may be handed to those posted
+    void poll() noexcept {
+        finish_(tasks_.has_finished() ? tasks_.reclaim() : 0);
+
+        stalled_ = false;
+        for (auto& ring : inbound_) {
+            if (!ring.run(*this)) { stalled_ = true; }
+        }
+    }
+
+    constexpr void flush() const noexcept {}
+
+    // a message which can't run yet doesn't wake the shard, as no context is free until one of its spawns finishes
+    void block(const std::optional<time_point> deadline) noexcept {
+        sleep_(deadline, [this] { return tasks_.has_finished() || (!stalled_ && has_message_()); });
+    }
+
+    void wake() noexcept {
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            woken_ = true;
+        }
+
+        condition_.notify_one();
+    }
+
+    // called by a sender once its message is published
+    void notify() noexcept {
+        if (sleeping_.load(std::memory_order_seq_cst)) { wake(); }
+    }
+
+    // steps until stopping once every spawn posted across the group has finished. Spawns left finished once the
+    // executor drains are reclaimed before sleeping, as nothing else would count them as finished
+    void run() noexcept {
+        executor_.attach(*this);
+
+        for (;;) {
+            executor_.step();
+            executor_.wait();
+
+            finish_(tasks_.reclaim());
+            if (finished_() && !has_message_()) { return; }
+
+            sleep_(std::nullopt, [this] { return has_message_() || finished_(); });
+        }
+    }
+
+    executor_shard& operator=(const executor_shard& other) = delete;
+    executor_shard(const executor_shard& other) = delete;
+
+    executor_shard(std::array<std::unique_ptr<executor_shard>, Shards>& peers, std::atomic_size_t& outstanding,
+                   std::atomic_bool& stopping) noexcept
+        : peers_{&peers}, outstanding_{&outstanding}, stopping_{&stopping} {}
+};
+
+}  // namespace detail
+
+// runs Shards executors of type X, each on its own thread pinned to a core and each constructed on that thread (so that
+// its contexts are allocated close to it). Shards share nothing but a ring of Q messages per ordered pair, over which
+// spawns are posted to one another, so state partitioned by shard is only ever touched by a single thread. Posting from
+// outside the shards is only supported from the thread owning the group. Destroying the group waits until every spawn
+// posted has finished
+template <typename X, std::size_t Shards, std::size_t Q = 256>
+class executor_group {
+   private:
+    static_assert(Shards > 0);
+
+    using shard_type = detail::executor_shard<X, Shards, Q>;
+
+    std::atomic_size_t outstanding_{0};
+    std::atomic_bool stopping_{false};
+    std::array<std::unique_ptr<shard_type>, Shards> shards_{};
+    std::latch constructed_{static_cast<std::ptrdiff_t>(Shards)};
+    std::array<std::jthread, Shards> threads_{};
+
+    // best effort, as the process may be restricted to fewer cores
+    static void pin_(const std::size_t index) noexcept {
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        static_cast<void>(pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus));
+    }
+
+    // the index of the ring the calling thread sends on
+    [[nodiscard]] std::size_t sender_() const noexcept {
+        return detail::current_shard_group == this ? detail::current_shard_index : Shards;
+    }
+
+   public:
+    static constexpr std::size_t shard_count = Shards;
+
+    // the shard the calling thread runs, if it is one of this group's
+    [[nodiscard]] std::optional<std::size_t> current_shard() const noexcept {
+        if (detail::current_shard_group != this) { return std::nullopt; }
+        return detail::current_shard_index;
+    }
+
+    // f is invoked on the shard with a free context and args, returning a task or continuation which the shard owns.
+    // Returns false, without posting, when the ring to the shard is full
+    template <typename F, typename... Args>
+    [[nodiscard]] bool try_post(const std::size_t shard, F&& f, Args&&... args) {
+        outstanding_.fetch_add(1, std::memory_order_seq_cst);
+
+        auto message = [function = std::forward<F>(f), ... arguments = std::forward<Args>(args)](
+                           shard_type& target) mutable { return target.try_spawn(function, arguments...); };
+
+        if (!shards_[shard]->inbound(sender_()).try_push(std::move(message))) {
+            outstanding_.fetch_sub(1, std::memory_order_seq_cst);
+            return false;
+        }
+
+        shards_[shard]->notify();
+        return true;
+    }
+
+    // terminates if the ring to the shard is full
+    template <typename F, typename... Args>
+    void post(const std::size_t shard, F&& f, Args&&... args) {
+        if (!try_post(shard, std::forward<F>(f), std::forward<Args>(args)...)) { std::terminate(); }
+    }
+
+    executor_group& operator=(const executor_group& other) = delete;
+    executor_group(const executor_group& other) = delete;
+
+    // returns once every shard is constructed, so that spawns may be posted to any of them
+    executor_group() {
+        for (std::size_t index = 0; index < Shards; ++index) {
+            threads_[index] = std::jthread([this, index] {
+                pin_(index);
+                detail::current_shard_group = this;
+                detail::current_shard_index = index;
+
+                shards_[index] = std::make_unique<shard_type>(shards_, outstanding_, stopping_);
+                constructed_.count_down();
+                shards_[index]->run();
+            });
+        }
+
+        constructed_.wait();
+    }
+
+    ~executor_group() noexcept {
+        stopping_.store(true, std::memory_order_seq_cst);
+        for (auto& shard : shards_) { shard->wake(); }
+        for (auto& thread : threads_) { thread.join(); }
+    }
+};
+
+namespace detail {
+
+// the reply to a nano::call, written by the remote shard into the caller's frame. It isn't abandonable, so a cancelled
+// caller still waits for it (and only then throws) rather than popping its frame from under the remote shard's write
+template <typename R>
+class call_reply {
+   private:
+    event<std::optional<R>> event_{};
+
+   public:
+    using awaiter_type = typename event<std::optional<R>>::awaiter_type;
+
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal) { return event_.awaiter(receiver_signal); }
+    void send(std::optional<R>&& value) noexcept { event_.send(std::move(value)); }
+};
+
+template <typename R, typename F, typename... Args>
+continuation<int> relay(coroutine_context context, call_reply<R>* result, F function, Args... args) {
+    std::optional<R> value{};
+
+    try {
+        value.emplace(co_await std::invoke(function, context, args...));
+    } catch (const operation_cancelled&) {}
+
+    result->send(std::move(value));
+    co_return 0;
+}
+
+}  // namespace detail
+
+// runs f (invoked with a context of the shard and args, returning a task or continuation) on a shard of the group,
+// yielding its result once complete. The caller yields while the ring to the shard is full, and is resumed by the
+// shard signalling it directly. Once posted, a cancelled call still waits for f to complete before throwing
+template <typename G, typename F, typename... Args,
+          typename R = typename std::invoke_result_t<F&, coroutine_context, Args&...>::return_type>
+continuation<R> call(coroutine_context, G& group, const std::size_t shard, F function, Args... args) {
+    detail::call_reply<R> result{};
+    while (!group.try_post(shard, detail::relay<R, F, Args...>, &result, function, args...)) {
+        co_await yield();
+    }
+
+    std::optional<R> value = co_await result;
+    if (!value.has_value()) { throw operation_cancelled(); }
+    co_return std::move(*value);
+}
+
+}  // namespace nano
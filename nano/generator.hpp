@@ -0,0 +1,287 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/continuation.hpp>
+#include <nano/detail.hpp>
+#include <nano/executor.hpp>
+
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace nano {
+
+// a lazily started coroutine producing a stream of values with co_yield. Its frame is allocated from the stack of the
+// context it is given, but it has no frame header of its own: it is resumed inline by whoever iterates over it, so it
+// may not co_await. A yielded value is referenced in place until the generator is next resumed
+template <typename T>
+class generator {
+   public:
+    using value_type = std::remove_cvref_t<T>;
+    using reference = std::remove_reference_t<T>&;
+
+    class promise_type;
+    class iterator;
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+   private:
+    handle_type handle_;
+
+   public:
+    class promise_type {
+       private:
+        std::remove_reference_t<T>* value_{nullptr};
+
+       public:
+        [[nodiscard]] constexpr reference value() const noexcept { return *value_; }
+
+        [[nodiscard]] generator<T> get_return_object() noexcept {
+            return generator<T>{handle_type::from_promise(*this)};
+        }
+
+        // the yielded object outlives the suspension, as the co_yield expression only completes on resumption
+        [[nodiscard]] std::suspend_always yield_value(std::remove_reference_t<T>& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        [[nodiscard]] std::suspend_always yield_value(std::remove_reference_t<T>&& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        template <typename O>
+        void await_transform(O&& object) = delete;
+
+        constexpr void return_void() const noexcept {}
+        void unhandled_exception() { throw; }
+
+        [[nodiscard]] constexpr std::suspend_always initial_suspend() const noexcept { return {}; }
+        [[nodiscard]] constexpr std::suspend_always final_suspend() const noexcept { return {}; }
+
+        promise_type(promise_type&& other) = delete;
+        promise_type(const promise_type& other) = delete;
+        promise_type& operator=(promise_type&& other) = delete;
+        promise_type& operator=(const promise_type& other) = delete;
+
+        [[nodiscard]] void* operator new(std::size_t n, coroutine_context context, auto&&...) {
+            return detail::allocate_detached_frame(context.stack.get(), n, std::alignment_of_v<promise_type>);
+        }
+
+        constexpr promise_type(coroutine_context, auto&&...) noexcept {}
+
+        void operator delete(void* ptr, std::size_t n) noexcept {
+            detail::deallocate_detached_frame(ptr, n, std::alignment_of_v<promise_type>);
+        }
+    };
+
+    class iterator {
+       private:
+        handle_type handle_{};
+
+       public:
+        using value_type = generator<T>::value_type;
+        using reference = generator<T>::reference;
+        using difference_type = std::ptrdiff_t;
+
+        [[nodiscard]] reference operator*() const noexcept { return handle_.promise().value(); }
+        [[nodiscard]] std::remove_reference_t<T>* operator->() const noexcept {
+            return std::addressof(handle_.promise().value());
+        }
+
+        iterator& operator++() {
+            handle_.resume();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        [[nodiscard]] friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept {
+            return it.handle_.done();
+        }
+
+        constexpr iterator() noexcept = default;
+        explicit constexpr iterator(handle_type handle) noexcept : handle_{handle} {}
+    };
+
+    // runs the generator up to its first co_yield
+    [[nodiscard]] iterator begin() {
+        handle_.resume();
+        return iterator{handle_};
+    }
+
+    [[nodiscard]] constexpr std::default_sentinel_t end() const noexcept { return {}; }
+
+    generator(generator<T>&& other) = delete;
+    generator(const generator<T>& other) = delete;
+
+    generator<T>& operator=(generator<T>&& other) = delete;
+    generator<T>& operator=(const generator<T>& other) = delete;
+
+    explicit generator(handle_type coroutine_handle) noexcept : handle_{coroutine_handle} {}
+    ~generator() noexcept { handle_.destroy(); }
+};
+
+// as generator, but consumed with co_await next() and free to co_await between its co_yields. It must be given the
+// context of the coroutine consuming it: it borrows that coroutine's frame header, which resumes the generator rather
+// than the consumer while the generator is suspended on an awaitable of its own
+template <typename T>
+class async_generator {
+   public:
+    using value_type = std::remove_cvref_t<T>;
+    using pointer = std::remove_reference_t<T>*;
+
+    class promise_type;
+    class next_request;
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+   private:
+    handle_type handle_;
+
+   public:
+    class promise_type {
+       private:
+        pointer value_{nullptr};
+        std::coroutine_handle<> consumer_{};
+        detail::coroutine_stack_frame_header_view frame_data_view_;
+
+        // control passes straight back to the consumer
+        struct yield_awaiter_type {
+            [[nodiscard]] constexpr bool await_ready() const noexcept { return false; }
+            constexpr void await_resume() const noexcept {}
+
+            [[nodiscard]] std::coroutine_handle<> await_suspend(handle_type handle) const noexcept {
+                return handle.promise().yield_to_consumer();
+            }
+        };
+
+       public:
+        [[nodiscard]] constexpr pointer value() const noexcept { return value_; }
+
+        // called with the consumer suspended: the consumer's frame header resumes the generator until it yields
+        [[nodiscard]] std::coroutine_handle<> resume_from(std::coroutine_handle<> consumer) noexcept {
+            consumer_ = consumer;
+            value_ = nullptr;
+
+            const auto handle = handle_type::from_promise(*this);
+            frame_data_view_.get().data().handle = handle;
+            return handle;
+        }
+
+        [[nodiscard]] std::coroutine_handle<> yield_to_consumer() noexcept {
+            frame_data_view_.get().data().handle = consumer_;
+            return consumer_;
+        }
+
+        [[nodiscard]] async_generator<T> get_return_object() noexcept {
+            return async_generator<T>{handle_type::from_promise(*this)};
+        }
+
+        [[nodiscard]] yield_awaiter_type yield_value(std::remove_reference_t<T>& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        [[nodiscard]] yield_awaiter_type yield_value(std::remove_reference_t<T>&& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        template <typename O>
+        [[nodiscard]] typename std::decay_t<O>::awaiter_type await_transform(O&& object) noexcept {
+            const auto ready_signal = frame_data_view_.get().data().ready_signal();
+            return object.awaiter(ready_signal);
+        }
+
+        template <typename T1, typename E1>
+        [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(continuation<T1, E1>& object) =
+            delete;
+
+        template <typename T1, typename E1>
+        [[nodiscard]] typename continuation<T1, E1>::awaiter_type await_transform(const continuation<T1, E1>& object) =
+            delete;
+
+        constexpr void return_void() const noexcept {}
+        constexpr void unhandled_exception() {}
+
+        [[nodiscard]] constexpr std::suspend_always initial_suspend() const noexcept { return {}; }
+        [[nodiscard]] constexpr yield_awaiter_type final_suspend() const noexcept { return {}; }
+
+        promise_type(promise_type&& other) = delete;
+        promise_type(const promise_type& other) = delete;
+        promise_type& operator=(promise_type&& other) = delete;
+        promise_type& operator=(const promise_type& other) = delete;
+
+        [[nodiscard]] void* operator new(std::size_t n, coroutine_context context, auto&&...) {
+            return detail::allocate_detached_frame(context.stack.get(), n, std::alignment_of_v<promise_type>);
+        }
+
+        promise_type(coroutine_context context, auto&&...) noexcept
+            : frame_data_view_{context.stack.get().peek_frame_header_view()} {}
+
+        void operator delete(void* ptr, std::size_t n) noexcept {
+            detail::deallocate_detached_frame(ptr, n, std::alignment_of_v<promise_type>);
+        }
+    };
+
+    class next_request {
+       private:
+        handle_type handle_;
+
+       public:
+        class awaiter_type {
+           private:
+            handle_type handle_;
+
+           public:
+            [[nodiscard]] bool await_ready() const noexcept { return handle_.done(); }
+            [[nodiscard]] pointer await_resume() const noexcept { return handle_.promise().value(); }
+
+            [[nodiscard]] std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) const noexcept {
+                return handle_.promise().resume_from(consumer);
+            }
+
+            explicit constexpr awaiter_type(handle_type handle) noexcept : handle_{handle} {}
+        };
+
+        // the consumer's ready signal is left alone: its frame header only resumes the generator until it yields
+        [[nodiscard]] awaiter_type awaiter(detail::signal) const noexcept { return awaiter_type{handle_}; }
+
+        explicit constexpr next_request(handle_type handle) noexcept : handle_{handle} {}
+    };
+
+    // resumes the generator until its next co_yield, producing a pointer to the yielded value or nullptr once done
+    [[nodiscard]] next_request next() const noexcept { return next_request{handle_}; }
+
+    async_generator(async_generator<T>&& other) = delete;
+    async_generator(const async_generator<T>& other) = delete;
+
+    async_generator<T>& operator=(async_generator<T>&& other) = delete;
+    async_generator<T>& operator=(const async_generator<T>& other) = delete;
+
+    explicit async_generator(handle_type coroutine_handle) noexcept : handle_{coroutine_handle} {}
+    ~async_generator() noexcept { handle_.destroy(); }
+};
+
+}  // namespace nano
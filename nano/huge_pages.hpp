@@ -0,0 +1,81 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include <sys/mman.h>
+
+namespace nano {
+
+namespace detail {
+
+inline constexpr std::size_t huge_page_size = std::size_t{2} * 1024 * 1024;
+
+template <typename T>
+struct huge_page_deleter {
+    std::size_t size_{0};
+
+    void operator()(T* ptr) const noexcept {
+        ptr->~T();
+        munmap(ptr, size_);
+    }
+};
+
+}  // namespace detail
+
+template <typename T>
+using huge_page_ptr = std::unique_ptr<T, detail::huge_page_deleter<T>>;
+
+// constructs T (e.g. an executor holding its stack buffers inline) in anonymous memory aligned to 2-MiB and advised to
+// be backed by transparent huge pages, so that scheduling passes over many contexts and their stacks share a handful
+// of TLB entries. Falls back to regular pages where transparent huge pages are disabled, and throws std::bad_alloc when
+// the range can't be mapped
+template <typename T, typename... Args>
+[[nodiscard]] huge_page_ptr<T> make_huge_page_backed(Args&&... args) {
+    constexpr std::size_t page_size = detail::huge_page_size;
+    const std::size_t size = (sizeof(T) + page_size - 1) / page_size * page_size;
+
+    // over-reserved by a page, the unaligned head and tail being unmapped again
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    void* reservation = mmap(nullptr, size + page_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (reservation == MAP_FAILED) { throw std::bad_alloc(); }
+
+    const auto address = reinterpret_cast<std::uintptr_t>(reservation);
+    const std::uintptr_t aligned = (address + page_size - 1) / page_size * page_size;
+    const std::size_t head = aligned - address;
+
+    if (head != 0) { munmap(reservation, head); }
+    if (head != page_size) { munmap(reinterpret_cast<void*>(aligned + size), page_size - head); }
+
+    void* memory = reinterpret_cast<void*>(aligned);
+    madvise(memory, size, MADV_HUGEPAGE);
+
+    try {
+        return huge_page_ptr<T>(new (memory) T(std::forward<Args>(args)...), detail::huge_page_deleter<T>{size});
+    } catch (...) {
+        munmap(memory, size);
+        throw;
+    }
+}
+
+}  // namespace nano
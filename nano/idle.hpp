@@ -0,0 +1,36 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace nano {
+
+namespace idle {
+
+// An idle executor keeps stepping, trading a busy core for the lowest possible wake-up latency
+class spin {};
+
+// An idle executor keeps stepping for Spins idle steps, then yields its thread for Yields idle steps and finally parks
+// until a frame is signalled ready
+template <std::size_t Spins = 4096, std::size_t Yields = 64>
+class adaptive {};
+
+}  // namespace idle
+
+}  // namespace nano
@@ -0,0 +1,227 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace nano {
+
+namespace detail {
+
+// bounded lock-free ring of N slots which any number of threads may push to while a single consumer pops. Each slot's
+// sequence tells producers when it is free and the consumer when its value is published
+template <typename T, std::size_t N>
+class mpsc_ring {
+   private:
+    static_assert(N > 0);
+
+    struct slot {
+        std::atomic_size_t sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+
+        [[nodiscard]] T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(64) std::atomic_size_t tail_{0};
+    alignas(64) std::size_t head_{0};
+    std::array<slot, N> slots_;
+
+    [[nodiscard]] slot& slot_(const std::size_t index) noexcept { return slots_[index % N]; }
+    [[nodiscard]] const slot& slot_(const std::size_t index) const noexcept { return slots_[index % N]; }
+
+    // claims count consecutive slots. Slots are freed in order by the single consumer, so the whole range is free as
+    // soon as its last slot is
+    [[nodiscard]] std::optional<std::size_t> reserve_(const std::size_t count) noexcept {
+        if (count == 0 || count > N) { return std::nullopt; }
+
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            const std::size_t last = tail + count - 1;
+            const std::size_t sequence = slot_(last).sequence.load(std::memory_order_acquire);
+
+            if (sequence == last) {
+                if (tail_.compare_exchange_weak(tail, tail + count, std::memory_order_relaxed)) { return tail; }
+            } else if (sequence < last) {
+                return std::nullopt;
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // sequentially consistent so that a consumer about to wait can't miss a message published before its wake-up check
+    void publish_(const std::size_t index, T value) noexcept {
+        slot& target = slot_(index);
+        ::new (static_cast<void*>(target.storage)) T(std::move(value));
+        target.sequence.store(index + 1, std::memory_order_seq_cst);
+    }
+
+   public:
+    [[nodiscard]] bool try_push(T value) noexcept {
+        const auto index = reserve_(1);
+        if (!index.has_value()) { return false; }
+
+        publish_(*index, std::move(value));
+        return true;
+    }
+
+    // either every value in [first, last) is pushed, as one contiguous batch, or none are
+    template <typename I>
+    [[nodiscard]] bool try_push(I first, I last) noexcept {
+        const auto count = static_cast<std::size_t>(std::distance(first, last));
+        const auto index = reserve_(count);
+        if (!index.has_value()) { return false; }
+
+        for (std::size_t offset = 0; first != last; ++first, ++offset) { publish_(*index + offset, *first); }
+        return true;
+    }
+
+    // consumer only
+    [[nodiscard]] bool has_value() const noexcept {
+        return slot_(head_).sequence.load(std::memory_order_seq_cst) == head_ + 1;
+    }
+
+    // consumer only
+    [[nodiscard]] std::optional<T> try_pop() noexcept {
+        slot& source = slot_(head_);
+        if (source.sequence.load(std::memory_order_acquire) != head_ + 1) { return std::nullopt; }
+
+        std::optional<T> result{std::move(*source.value())};
+        std::destroy_at(source.value());
+        source.sequence.store(head_ + N, std::memory_order_release);
+
+        ++head_;
+        return result;
+    }
+
+    mpsc_ring<T, N>& operator=(const mpsc_ring<T, N>& other) = delete;
+    mpsc_ring(const mpsc_ring<T, N>& other) = delete;
+
+    mpsc_ring() noexcept {
+        for (std::size_t index = 0; index < N; ++index) {
+            slots_[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    ~mpsc_ring() noexcept {
+        while (try_pop().has_value()) {}
+    }
+};
+
+}  // namespace detail
+
+// Lock-free queue of up to N messages which any thread may send to a single coroutine. Awaiting the inbox yields the
+// next message without suspending while messages remain, so the receiving coroutine is only woken once per batch of
+// messages rather than once per message. Once the inbox is closed and drained, awaiting it yields std::nullopt.
+template <typename T, std::size_t N>
+class inbox {
+   private:
+    detail::mpsc_ring<T, N> ring_{};
+    std::atomic_bool closed_{false};
+
+    std::atomic_bool waiting_{false};
+    detail::signal receiver_signal_{detail::signal::make_detached()};
+
+    [[nodiscard]] bool has_message_or_closed_() const noexcept {
+        return ring_.has_value() || closed_.load(std::memory_order_seq_cst);
+    }
+
+    void wake_() noexcept {
+        if (!waiting_.load(std::memory_order_seq_cst)) { return; }
+        if (!waiting_.exchange(false, std::memory_order_acq_rel)) { return; }
+
+        // copied first, as the receiver may register again as soon as it is signalled
+        const detail::signal receiver_signal = receiver_signal_;
+        receiver_signal.set(true);
+    }
+
+   public:
+    class awaiter_type {
+       private:
+        detail::view<inbox<T, N>> inbox_;
+        bool ready_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+        [[nodiscard]] std::optional<T> await_resume() noexcept { return inbox_.get().ring_.try_pop(); }
+        constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+        awaiter_type(detail::view<inbox<T, N>> inbox_view, const bool ready) noexcept
+            : inbox_{inbox_view}, ready_{ready} {}
+    };
+
+    // returns false when the inbox is full
+    [[nodiscard]] bool try_send(T value) noexcept {
+        if (!ring_.try_push(std::move(value))) { return false; }
+
+        wake_();
+        return true;
+    }
+
+    // sends every message in [first, last) or, when they don't fit, none of them
+    template <typename I>
+    [[nodiscard]] bool try_send(I first, I last) noexcept {
+        if (!ring_.try_push(first, last)) { return false; }
+
+        wake_();
+        return true;
+    }
+
+    // the receiver drains any remaining messages before observing std::nullopt
+    void close() noexcept {
+        closed_.store(true, std::memory_order_seq_cst);
+        wake_();
+    }
+
+    // receiver only
+    [[nodiscard]] std::optional<T> try_receive() noexcept { return ring_.try_pop(); }
+
+    // the receiver only suspends when it registered before any message arrived, so its signal is never set once it has
+    // moved on to await something else
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) noexcept {
+        if (has_message_or_closed_()) { return awaiter_type{detail::view(*this), true}; }
+
+        receiver_signal_ = receiver_signal;
+        receiver_signal.set(false);
+        waiting_.store(true, std::memory_order_seq_cst);
+
+        if (has_message_or_closed_() && waiting_.exchange(false, std::memory_order_acq_rel)) {
+            return awaiter_type{detail::view(*this), true};
+        }
+
+        return awaiter_type{detail::view(*this), false};
+    }
+
+    inbox<T, N>& operator=(const inbox<T, N>& other) = delete;
+    inbox(const inbox<T, N>& other) = delete;
+
+    inbox() = default;
+};
+
+}  // namespace nano
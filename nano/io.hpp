@@ -0,0 +1,467 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace nano {
+
+namespace detail {
+
+// a request in flight, living in the awaiter of the suspended coroutine which made it. The requests in flight are
+// linked on their ring, which cancels those flagged (from any thread) at its next poll
+struct io_operation {
+    signal signal_{signal::make_detached()};
+    std::int32_t result_{0};
+    std::atomic_bool cancel_requested_{false};
+    io_operation* prev_{nullptr};
+    io_operation* next_{nullptr};
+};
+
+}  // namespace detail
+
+namespace io {
+
+// An io_uring (Linux 5.11+) driven by a single-threaded executor it is attached to. Requests made during a step are
+// submitted together by a single system call at its end, and completions are reaped from shared memory at the start
+// of the next step, so a step costs at most one system call however many requests it makes.
+class ring {
+   private:
+    // identifies the completion of the read keeping the ring's eventfd armed
+    static constexpr std::uint64_t wake_data = 0;
+
+    // identifies the completion of a request cancelling another
+    static constexpr std::uint64_t cancel_data = 1;
+
+    int fd_{-1};
+    int wake_fd_{-1};
+    std::uint64_t wake_buffer_{0};
+    bool wake_armed_{false};
+
+    void* sq_ring_{MAP_FAILED};
+    std::size_t sq_ring_size_{0};
+    void* cq_ring_{MAP_FAILED};
+    std::size_t cq_ring_size_{0};
+    io_uring_sqe* sqes_{static_cast<io_uring_sqe*>(MAP_FAILED)};
+    std::size_t sqes_size_{0};
+
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+    unsigned cq_mask_{0};
+
+    unsigned unsubmitted_{0};
+
+    detail::io_operation* in_flight_{nullptr};
+    std::atomic_bool cancel_pending_{false};
+
+    [[nodiscard]] static std::system_error error_(const char* what) noexcept {
+        return std::system_error(errno, std::system_category(), what);
+    }
+
+    template <typename T>
+    [[nodiscard]] static T* at_(void* base, const std::uint32_t offset) noexcept {
+        return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset);
+    }
+
+    int enter_(const unsigned to_submit, const unsigned min_complete, const unsigned flags, const void* arg,
+               const std::size_t arg_size) noexcept {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, arg, arg_size));
+    }
+
+    void arm_wake_() noexcept {
+        if (wake_armed_) { return; }
+
+        io_uring_sqe& sqe = acquire();
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = wake_fd_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&wake_buffer_);
+        sqe.len = sizeof(wake_buffer_);
+        sqe.user_data = wake_data;
+        commit();
+
+        wake_armed_ = true;
+    }
+
+    void untrack_(detail::io_operation& operation) noexcept {
+        if (operation.prev_ == nullptr) {
+            in_flight_ = operation.next_;
+        } else {
+            operation.prev_->next_ = operation.next_;
+        }
+
+        if (operation.next_ != nullptr) { operation.next_->prev_ = operation.prev_; }
+    }
+
+    // the cancelled requests complete in turn, typically with -ECANCELED (or their result, if they completed first)
+    void submit_cancellations_() noexcept {
+        if (!cancel_pending_.exchange(false, std::memory_order_acquire)) { return; }
+
+        for (detail::io_operation* operation = in_flight_; operation != nullptr; operation = operation->next_) {
+            if (!operation->cancel_requested_.exchange(false, std::memory_order_relaxed)) { continue; }
+
+            io_uring_sqe& sqe = acquire();
+            sqe.opcode = IORING_OP_ASYNC_CANCEL;
+            sqe.fd = -1;
+            sqe.addr = reinterpret_cast<std::uint64_t>(operation);
+            sqe.user_data = cancel_data;
+            commit();
+        }
+    }
+
+    void release_() noexcept {
+        if (sqes_ != MAP_FAILED) { munmap(sqes_, sqes_size_); }
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) { munmap(cq_ring_, cq_ring_size_); }
+        if (sq_ring_ != MAP_FAILED) { munmap(sq_ring_, sq_ring_size_); }
+        if (wake_fd_ >= 0) { close(wake_fd_); }
+        if (fd_ >= 0) { close(fd_); }
+    }
+
+   public:
+    // the returned entry must be filled in and committed before the ring is used again. When the submission queue is
+    // full, the pending entries are submitted early to make room
+    [[nodiscard]] io_uring_sqe& acquire() noexcept {
+        const unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        const unsigned tail = *sq_tail_;
+        if (tail - head == sq_entries_) { flush(); }
+
+        io_uring_sqe& sqe = sqes_[*sq_tail_ & sq_mask_];
+        std::memset(&sqe, 0, sizeof(sqe));
+        return sqe;
+    }
+
+    void commit() noexcept {
+        const unsigned tail = *sq_tail_;
+        sq_array_[tail & sq_mask_] = tail & sq_mask_;
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+        ++unsubmitted_;
+    }
+
+    // links a request about to be submitted, so that it can be cancelled in flight
+    void track(detail::io_operation& operation) noexcept {
+        operation.prev_ = nullptr;
+        operation.next_ = in_flight_;
+        if (in_flight_ != nullptr) { in_flight_->prev_ = &operation; }
+
+        in_flight_ = &operation;
+    }
+
+    // may be called from any thread while the request is in flight, which is then cancelled at the next poll
+    void cancel(detail::io_operation& operation) noexcept {
+        operation.cancel_requested_.store(true, std::memory_order_relaxed);
+        cancel_pending_.store(true, std::memory_order_release);
+        wake();
+    }
+
+    // signals the coroutine of every completed request, and submits the cancellation of those flagged since
+    void poll() noexcept {
+        unsigned head = *cq_head_;
+        const unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+
+            if (cqe.user_data == wake_data) {
+                wake_armed_ = false;
+                continue;
+            }
+
+            if (cqe.user_data == cancel_data) { continue; }
+
+            auto* operation = reinterpret_cast<detail::io_operation*>(cqe.user_data);
+            operation->result_ = cqe.res;
+            untrack_(*operation);
+
+            // copied first, as the coroutine may destroy the operation once signalled
+            const detail::signal completed = operation->signal_;
+            completed.set(true);
+        }
+
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        submit_cancellations_();
+    }
+
+    void flush() noexcept {
+        if (unsubmitted_ == 0) { return; }
+
+        const unsigned to_submit = unsubmitted_;
+        unsubmitted_ = 0;
+        while (enter_(to_submit, 0, 0, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+
+    // submits pending requests and waits for any completion, a call to wake() or the deadline in a single system call
+    void block(const std::optional<std::chrono::steady_clock::time_point> deadline) noexcept {
+        arm_wake_();
+
+        const unsigned to_submit = std::exchange(unsubmitted_, 0);
+        unsigned flags = IORING_ENTER_GETEVENTS;
+
+        __kernel_timespec timeout{};
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+
+        if (deadline.has_value()) {
+            const auto remaining = std::max(*deadline - std::chrono::steady_clock::now(), std::chrono::nanoseconds{0});
+            const auto seconds = std::chrono::floor<std::chrono::seconds>(remaining);
+            timeout.tv_sec = seconds.count();
+            timeout.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - seconds).count();
+
+            arg.ts = reinterpret_cast<std::uint64_t>(&timeout);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+
+        const void* enter_arg = deadline.has_value() ? static_cast<const void*>(&arg) : nullptr;
+        const std::size_t enter_arg_size = deadline.has_value() ? sizeof(arg) : 0;
+        enter_(to_submit, 1, flags, enter_arg, enter_arg_size);
+    }
+
+    // may be called from any thread
+    void wake() noexcept {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(wake_fd_, &one, sizeof(one));
+    }
+
+    ring& operator=(const ring& other) = delete;
+    ring(const ring& other) = delete;
+
+    // throws std::system_error when io_uring is unavailable
+    explicit ring(const unsigned entries = 256) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) { throw error_("io_uring_setup"); }
+
+        wake_fd_ = eventfd(0, EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            const auto error = error_("eventfd");
+            release_();
+            throw error;
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+
+        sq_ring_ =
+            mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0
+                       ? sq_ring_
+                       : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                              IORING_OFF_CQ_RING);
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(
+            mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            const auto error = error_("mmap");
+            release_();
+            throw error;
+        }
+
+        sq_head_ = at_<unsigned>(sq_ring_, params.sq_off.head);
+        sq_tail_ = at_<unsigned>(sq_ring_, params.sq_off.tail);
+        sq_array_ = at_<unsigned>(sq_ring_, params.sq_off.array);
+        sq_mask_ = *at_<unsigned>(sq_ring_, params.sq_off.ring_mask);
+        sq_entries_ = *at_<unsigned>(sq_ring_, params.sq_off.ring_entries);
+
+        cq_head_ = at_<unsigned>(cq_ring_, params.cq_off.head);
+        cq_tail_ = at_<unsigned>(cq_ring_, params.cq_off.tail);
+        cqes_ = at_<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+        cq_mask_ = *at_<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    }
+
+    ~ring() noexcept { release_(); }
+};
+
+}  // namespace io
+
+namespace detail {
+
+// the fields of a submission queue entry set by a request. io_uring_sqe isn't held directly, as its trailing
+// zero-size array makes it ill-formed as a member in standard C++
+struct io_submission {
+    std::uint8_t opcode{0};
+    std::int32_t fd{-1};
+    std::uint64_t off{0};
+    std::uint64_t addr{0};
+    std::uint32_t len{0};
+
+    // the per-opcode flags (e.g. msg_flags or accept_flags), which share a union in io_uring_sqe
+    std::uint32_t op_flags{0};
+
+    void write_to(io_uring_sqe& sqe) const noexcept {
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.off = off;
+        sqe.addr = addr;
+        sqe.len = len;
+        sqe.rw_flags = op_flags;
+    }
+};
+
+// suspends the receiver until the request it was constructed with completes, yielding its result (a negative errno
+// on failure). The request is only queued once suspended, when the address of its operation is final
+class io_awaiter {
+   private:
+    io::ring* ring_;
+    io_submission request_;
+    io_operation operation_{};
+
+   public:
+    [[nodiscard]] constexpr bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<>) noexcept {
+        io_uring_sqe& sqe = ring_->acquire();
+        request_.write_to(sqe);
+        sqe.user_data = reinterpret_cast<std::uint64_t>(&operation_);
+        ring_->track(operation_);
+        ring_->commit();
+    }
+
+    [[nodiscard]] constexpr std::int32_t await_resume() const noexcept { return operation_.result_; }
+
+    // may be called from any thread, the request then completing early (see nano::cancellation_source)
+    void interrupt() noexcept { ring_->cancel(operation_); }
+
+    io_awaiter& operator=(const io_awaiter& other) = delete;
+    io_awaiter(const io_awaiter& other) = delete;
+
+    io_awaiter(signal receiver_signal, io::ring& uring, const io_submission& request) noexcept
+        : ring_{&uring}, request_{request} {
+        operation_.signal_ = receiver_signal;
+        receiver_signal.set(false);
+    }
+};
+
+class io_request {
+   protected:
+    io::ring* ring_;
+    io_submission request_{};
+
+    io_request(io::ring& uring, const std::uint8_t opcode, const int fd) noexcept : ring_{&uring} {
+        request_.opcode = opcode;
+        request_.fd = fd;
+    }
+
+   public:
+    using awaiter_type = io_awaiter;
+
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal) noexcept {
+        return awaiter_type(receiver_signal, *ring_, request_);
+    }
+};
+
+}  // namespace detail
+
+namespace io {
+
+// reads into buffer at offset, or at the file position when offset is -1, yielding the byte count
+class read : public detail::io_request {
+   public:
+    read(ring& uring, const int fd, const std::span<std::byte> buffer, const std::uint64_t offset = -1) noexcept
+        : io_request(uring, IORING_OP_READ, fd) {
+        request_.addr = reinterpret_cast<std::uint64_t>(buffer.data());
+        request_.len = static_cast<std::uint32_t>(buffer.size());
+        request_.off = offset;
+    }
+};
+
+// writes buffer at offset, or at the file position when offset is -1, yielding the byte count
+class write : public detail::io_request {
+   public:
+    write(ring& uring, const int fd, const std::span<const std::byte> buffer, const std::uint64_t offset = -1) noexcept
+        : io_request(uring, IORING_OP_WRITE, fd) {
+        request_.addr = reinterpret_cast<std::uint64_t>(buffer.data());
+        request_.len = static_cast<std::uint32_t>(buffer.size());
+        request_.off = offset;
+    }
+};
+
+// yields the accepted socket
+class accept : public detail::io_request {
+   public:
+    accept(ring& uring, const int fd, const int flags = SOCK_CLOEXEC) noexcept
+        : io_request(uring, IORING_OP_ACCEPT, fd) {
+        request_.op_flags = static_cast<std::uint32_t>(flags);
+    }
+};
+
+// yields zero once connected. The address must outlive the await
+class connect : public detail::io_request {
+   public:
+    connect(ring& uring, const int fd, const sockaddr* address, const socklen_t length) noexcept
+        : io_request(uring, IORING_OP_CONNECT, fd) {
+        request_.addr = reinterpret_cast<std::uint64_t>(address);
+        request_.off = length;
+    }
+};
+
+// yields the received byte count, zero once the peer has shut down
+class recv : public detail::io_request {
+   public:
+    recv(ring& uring, const int fd, const std::span<std::byte> buffer, const int flags = 0) noexcept
+        : io_request(uring, IORING_OP_RECV, fd) {
+        request_.addr = reinterpret_cast<std::uint64_t>(buffer.data());
+        request_.len = static_cast<std::uint32_t>(buffer.size());
+        request_.op_flags = static_cast<std::uint32_t>(flags);
+    }
+};
+
+// yields the sent byte count
+class send : public detail::io_request {
+   public:
+    send(ring& uring, const int fd, const std::span<const std::byte> buffer, const int flags = 0) noexcept
+        : io_request(uring, IORING_OP_SEND, fd) {
+        request_.addr = reinterpret_cast<std::uint64_t>(buffer.data());
+        request_.len = static_cast<std::uint32_t>(buffer.size());
+        request_.op_flags = static_cast<std::uint32_t>(flags | MSG_NOSIGNAL);
+    }
+};
+
+}  // namespace io
+
+}  // namespace nano
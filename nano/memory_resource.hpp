@@ -0,0 +1,82 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace nano {
+
+// scratch memory for the coroutine running on a context (e.g. for a std::pmr::vector or std::pmr::string), bumped off
+// its stack just past its own frame and released in bulk once that frame is destroyed. It must be created by the
+// running coroutine, and nothing allocated from it may outlive that coroutine (e.g. as its result). Memory is taken
+// from upstream instead when the stack is full, or while another frame's memory sits above the coroutine's (e.g. a
+// lazy coroutine yet to be awaited, or a finished nano::task not yet destroyed), as that memory would be released
+// along with the other frame
+class stack_memory_resource : public std::pmr::memory_resource {
+   private:
+    detail::coroutine_stack* stack_;
+    const detail::coroutine_stack_frame_header* frame_;
+    std::pmr::memory_resource* upstream_;
+
+    [[nodiscard]] bool owns_top_() const noexcept {
+        return frame_ != nullptr && stack_->top_reservation_ == &frame_->reservation_;
+    }
+
+   protected:
+    [[nodiscard]] void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+        if (owns_top_()) {
+            if (void* ptr = stack_->allocate_(bytes, alignment); ptr != nullptr) {
+                stack_->record_high_water_mark_();
+                return ptr;
+            }
+        }
+
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    // the memory is reclaimed immediately when nothing has been allocated past it since, and otherwise once the frame
+    // is destroyed
+    void do_deallocate(void* ptr, const std::size_t bytes, const std::size_t alignment) override {
+        if (!stack_->contains(ptr)) {
+            upstream_->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        if (std::byte* byte_ptr = static_cast<std::byte*>(ptr); byte_ptr + bytes == stack_->tail_) {
+            stack_->tail_ = byte_ptr;
+            stack_->space_ = static_cast<std::size_t>(stack_->end_ - byte_ptr);
+        }
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+   public:
+    stack_memory_resource& operator=(const stack_memory_resource& other) = delete;
+    stack_memory_resource(const stack_memory_resource& other) = delete;
+
+    explicit stack_memory_resource(detail::coroutine_stack& stack,
+                                   std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : stack_{&stack}, frame_{stack.empty() ? nullptr : &stack.peek_frame_header()}, upstream_{upstream} {}
+};
+
+}  // namespace nano
@@ -0,0 +1,90 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace nano {
+
+namespace detail {
+
+// MADV_GUARD_INSTALL (Linux 6.13+) installs a guard region without splitting the mapping, which older headers lack
+inline constexpr int madvise_guard_install = 102;
+
+[[nodiscard]] inline std::size_t page_size() noexcept {
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+}  // namespace detail
+
+// N bytes of reserved virtual memory, ending at an inaccessible guard page. Pages are only backed by physical memory
+// once first touched, so resident memory follows the deepest use of the stack rather than N, and may be returned to
+// the OS with decommit() while the stack is unused. The guard page is installed without splitting the mapping where
+// the kernel supports it, otherwise each buffer occupies two mappings (see vm.max_map_count)
+template <std::size_t N>
+class mmap_buffer {
+   private:
+    std::byte* reservation_{nullptr};
+    std::size_t reservation_size_{0};
+    std::byte* data_{nullptr};
+
+   public:
+    [[nodiscard]] constexpr std::byte* data() noexcept { return data_; }
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return N; }
+
+    // the contents of the buffer read as zero once next touched
+    void decommit() noexcept { madvise(reservation_, reservation_size_ - detail::page_size(), MADV_DONTNEED); }
+
+    mmap_buffer<N>& operator=(const mmap_buffer<N>& other) = delete;
+    mmap_buffer(const mmap_buffer<N>& other) = delete;
+
+    mmap_buffer<N>& operator=(const mmap_buffer<N>&& other) = delete;
+    mmap_buffer(const mmap_buffer<N>&& other) = delete;
+
+    // throws std::bad_alloc when the range can't be reserved
+    mmap_buffer() {
+        const std::size_t page_size = detail::page_size();
+        const std::size_t usable_size = (N + page_size - 1) / page_size * page_size;
+        reservation_size_ = usable_size + page_size;
+
+        constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+        void* reservation = mmap(nullptr, reservation_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (reservation == MAP_FAILED) { throw std::bad_alloc(); }
+
+        reservation_ = static_cast<std::byte*>(reservation);
+        data_ = reservation_ + usable_size - N;
+
+        std::byte* guard = reservation_ + usable_size;
+        const bool guarded = madvise(guard, page_size, detail::madvise_guard_install) == 0 ||
+                             mprotect(guard, page_size, PROT_NONE) == 0;
+
+        if (!guarded) {
+            munmap(reservation_, reservation_size_);
+            throw std::bad_alloc();
+        }
+    }
+
+    ~mmap_buffer() noexcept { munmap(reservation_, reservation_size_); }
+};
+
+}  // namespace nano
@@ -20,10 +20,154 @@
 #include <nano/continuation.hpp>
 #include <nano/detail.hpp>
 #include <nano/executor.hpp>
-#include <nano/yield.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
 
 namespace nano {
 
+namespace detail {
+
+// a suspended coroutine queued on a mutex, semaphore or shared_mutex, living in the awaiter of its frame
+struct lock_waiter {
+    signal signal_{signal::make_detached()};
+    std::atomic_bool* delivered_{nullptr};
+    lock_waiter* next_{nullptr};
+    bool shared_{false};
+};
+
+// intrusive FIFO of waiters of type W (linked through next_), guarded by whatever owns it
+template <typename W>
+class basic_waiter_queue {
+   private:
+    W* head_{nullptr};
+    W* tail_{nullptr};
+
+   public:
+    [[nodiscard]] constexpr bool empty() const noexcept { return head_ == nullptr; }
+    [[nodiscard]] constexpr W& front() noexcept { return *head_; }
+    [[nodiscard]] constexpr const W& front() const noexcept { return *head_; }
+
+    constexpr void push(W& waiter) noexcept {
+        waiter.next_ = nullptr;
+        if (tail_ == nullptr) {
+            head_ = &waiter;
+        } else {
+            tail_->next_ = &waiter;
+        }
+
+        tail_ = &waiter;
+    }
+
+    [[nodiscard]] constexpr W* pop() noexcept {
+        W* waiter = head_;
+        head_ = waiter->next_;
+        if (head_ == nullptr) { tail_ = nullptr; }
+
+        waiter->next_ = nullptr;
+        return waiter;
+    }
+
+    // unlinks every waiter at once, returning them still linked in order
+    [[nodiscard]] constexpr W* pop_all() noexcept {
+        tail_ = nullptr;
+        return std::exchange(head_, nullptr);
+    }
+
+    // linear, as a waiter is only removed from the middle of the queue when abandoned
+    [[nodiscard]] constexpr bool remove(W& waiter) noexcept {
+        W* previous = nullptr;
+        for (W* current = head_; current != nullptr; previous = current, current = current->next_) {
+            if (current != &waiter) { continue; }
+
+            (previous == nullptr ? head_ : previous->next_) = current->next_;
+            if (tail_ == current) { tail_ = previous; }
+
+            current->next_ = nullptr;
+            return true;
+        }
+
+        return false;
+    }
+};
+
+// guarded by the spin lock of the mutex, semaphore or shared_mutex owning it
+using waiter_queue = basic_waiter_queue<lock_waiter>;
+
+// resumes waiters which were handed ownership, after the primitive's spin lock has been released. Each waiter's
+// link, signal and delivered flag are read before it is signalled, as it may be destroyed from another thread as soon
+// as it is (or, when it failed to withdraw, as soon as delivered is set)
+inline void wake(lock_waiter* waiter) noexcept {
+    while (waiter != nullptr) {
+        lock_waiter* next = waiter->next_;
+        const signal granted = waiter->signal_;
+        std::atomic_bool* const delivered = waiter->delivered_;
+
+        granted.set(true);
+        if (delivered != nullptr) { delivered->store(true, std::memory_order_release); }
+        waiter = next;
+    }
+}
+
+// suspends the receiver until ownership of the primitive is acquired, yielding a guard of type G releasing it. A
+// waiter is only queued once suspended, when its address is final, and is woken by the releasing coroutine handing
+// ownership over directly, so contenders are never resumed just to find the primitive still held
+template <typename T, typename G>
+class acquire_awaiter {
+   private:
+    enum class stage : std::uint8_t { pending, queued, acquired };
+
+    T* primitive_;
+    lock_waiter waiter_{};
+    stage stage_;
+
+   public:
+    [[nodiscard]] constexpr bool await_ready() const noexcept { return stage_ == stage::acquired; }
+    [[nodiscard]] G await_resume() const noexcept { return G(primitive_); }
+
+    [[nodiscard]] bool await_suspend(std::coroutine_handle<>) noexcept {
+        stage_ = primitive_->enqueue_(waiter_) ? stage::queued : stage::acquired;
+        return stage_ == stage::queued;
+    }
+
+    // returns false when ownership was handed over first, after which delivered (if provided) is set once the waiter
+    // has been signalled
+    [[nodiscard]] bool detach() noexcept { return stage_ == stage::pending || primitive_->dequeue_(waiter_); }
+
+    acquire_awaiter& operator=(const acquire_awaiter& other) = delete;
+    acquire_awaiter(const acquire_awaiter& other) = delete;
+
+    acquire_awaiter(signal receiver_signal, T& primitive, const bool shared = false,
+                    std::atomic_bool* delivered = nullptr) noexcept
+        : primitive_{&primitive}, stage_{primitive.try_acquire_(shared) ? stage::acquired : stage::pending} {
+        waiter_.signal_ = receiver_signal;
+        waiter_.delivered_ = delivered;
+        waiter_.shared_ = shared;
+        if (stage_ != stage::acquired) { receiver_signal.set(false); }
+    }
+};
+
+template <typename T, typename G, bool Shared>
+class acquire_request {
+   private:
+    T* primitive_;
+
+   public:
+    using awaiter_type = acquire_awaiter<T, G>;
+
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal, std::atomic_bool* delivered = nullptr) noexcept {
+        return awaiter_type(receiver_signal, *primitive_, Shared, delivered);
+    }
+
+    explicit acquire_request(T& primitive) noexcept : primitive_{&primitive} {}
+};
+
+}  // namespace detail
+
 template <typename T>
 class lock_guard {
    private:
@@ -44,29 +188,303 @@ class lock_guard {
     lock_guard<T>& operator=(const lock_guard<T>& other) = delete;
     lock_guard(lock_guard<T>& other) = delete;
 
-    lock_guard(T* mutex) noexcept : mutex_{mutex} {
-        if (mutex_ != nullptr) { mutex_->available_ = false; }
-    }
+    // adopts ownership already acquired
+    lock_guard(T* mutex) noexcept : mutex_{mutex} {}
 
     ~lock_guard() noexcept {
-        if (mutex_ != nullptr) { mutex_->available_ = true; }
+        if (mutex_ != nullptr) { mutex_->release_(); }
     }
 };
 
 template <typename T>
-continuation<lock_guard<T>> lock(coroutine_context, T& mutex) {
-    while (!mutex.available_) { co_await yield(); }
+class shared_lock_guard {
+   private:
+    T* mutex_;
 
-    mutex.available_ = false;
-    co_return lock_guard(&mutex);
-}
+   public:
+    shared_lock_guard(shared_lock_guard<T>&& other) {
+        mutex_ = other.mutex_;
+        other.mutex_ = nullptr;
+    }
 
+    shared_lock_guard<T>& operator=(shared_lock_guard<T>&& other) {
+        mutex_ = other.mutex_;
+        other.mutex_ = nullptr;
+        return *this;
+    }
+
+    shared_lock_guard<T>& operator=(const shared_lock_guard<T>& other) = delete;
+    shared_lock_guard(shared_lock_guard<T>& other) = delete;
+
+    // adopts shared ownership already acquired
+    shared_lock_guard(T* mutex) noexcept : mutex_{mutex} {}
+
+    ~shared_lock_guard() noexcept {
+        if (mutex_ != nullptr) { mutex_->release_shared_(); }
+    }
+};
+
+// waiters acquire the mutex in the order they began waiting, each unlock handing it directly to the next
 class mutex {
    private:
-    bool available_{true};
+    detail::spin_lock lock_{};
+    detail::waiter_queue waiters_{};
+    bool locked_{false};
+
+    [[nodiscard]] std::unique_lock<detail::spin_lock> guard_() noexcept {
+        return std::unique_lock<detail::spin_lock>(lock_);
+    }
+
+    [[nodiscard]] bool try_acquire_(const bool) noexcept {
+        const auto guard = guard_();
+        if (locked_) { return false; }
+
+        locked_ = true;
+        return true;
+    }
+
+    // false when the mutex was acquired after all, in which case the receiver resumes immediately
+    [[nodiscard]] bool enqueue_(detail::lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (!locked_) {
+            locked_ = true;
+            return false;
+        }
+
+        waiters_.push(waiter);
+        return true;
+    }
+
+    [[nodiscard]] bool dequeue_(detail::lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        return waiters_.remove(waiter);
+    }
+
+    void release_() noexcept {
+        detail::lock_waiter* next = nullptr;
+
+        {
+            const auto guard = guard_();
+            if (waiters_.empty()) {
+                locked_ = false;
+            } else {
+                next = waiters_.pop();
+            }
+        }
+
+        detail::wake(next);
+    }
+
+    template <typename T, typename G>
+    friend class detail::acquire_awaiter;
 
     friend class lock_guard<mutex>;
-    friend continuation<lock_guard<mutex>> lock<mutex>(coroutine_context, mutex&);
 };
 
+// waiters acquire a unit in the order they began waiting, each release handing its unit directly to the next
+class semaphore {
+   private:
+    detail::spin_lock lock_{};
+    detail::waiter_queue waiters_{};
+    std::size_t count_;
+
+    [[nodiscard]] std::unique_lock<detail::spin_lock> guard_() noexcept {
+        return std::unique_lock<detail::spin_lock>(lock_);
+    }
+
+    [[nodiscard]] bool try_acquire_(const bool) noexcept {
+        const auto guard = guard_();
+        if (count_ == 0) { return false; }
+
+        --count_;
+        return true;
+    }
+
+    [[nodiscard]] bool enqueue_(detail::lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (count_ != 0) {
+            --count_;
+            return false;
+        }
+
+        waiters_.push(waiter);
+        return true;
+    }
+
+    [[nodiscard]] bool dequeue_(detail::lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        return waiters_.remove(waiter);
+    }
+
+    void release_() noexcept {
+        detail::lock_waiter* next = nullptr;
+
+        {
+            const auto guard = guard_();
+            if (waiters_.empty()) {
+                ++count_;
+            } else {
+                next = waiters_.pop();
+            }
+        }
+
+        detail::wake(next);
+    }
+
+    template <typename T, typename G>
+    friend class detail::acquire_awaiter;
+
+    friend class lock_guard<semaphore>;
+
+   public:
+    semaphore& operator=(const semaphore& other) = delete;
+    semaphore(const semaphore& other) = delete;
+
+    explicit semaphore(const std::size_t count) noexcept : count_{count} {}
+};
+
+// readers share ownership while no writer holds or waits for it. Ownership is handed over in the order waiting began:
+// a writer releasing hands it to the next writer or to every reader queued ahead of the next writer, and the last
+// reader releasing hands it to the next writer
+class shared_mutex {
+   private:
+    detail::spin_lock lock_{};
+    detail::waiter_queue waiters_{};
+    std::size_t readers_{0};
+    bool writer_{false};
+
+    [[nodiscard]] std::unique_lock<detail::spin_lock> guard_() noexcept {
+        return std::unique_lock<detail::spin_lock>(lock_);
+    }
+
+    // a reader only barges in ahead of a queued writer when it holds ownership with other readers
+    [[nodiscard]] bool acquirable_(const bool shared) const noexcept {
+        if (shared) { return !writer_ && waiters_.empty(); }
+        return !writer_ && readers_ == 0;
+    }
+
+    void acquire_(const bool shared) noexcept {
+        if (shared) {
+            ++readers_;
+        } else {
+            writer_ = true;
+        }
+    }
+
+    [[nodiscard]] bool try_acquire_(const bool shared) noexcept {
+        const auto guard = guard_();
+        if (!acquirable_(shared)) { return false; }
+
+        acquire_(shared);
+        return true;
+    }
+
+    [[nodiscard]] bool enqueue_(detail::lock_waiter& waiter) noexcept {
+        const auto guard = guard_();
+        if (acquirable_(waiter.shared_)) {
+            acquire_(waiter.shared_);
+            return false;
+        }
+
+        waiters_.push(waiter);
+        return true;
+    }
+
+    // readers queued behind a withdrawn writer join those already holding ownership
+    [[nodiscard]] bool dequeue_(detail::lock_waiter& waiter) noexcept {
+        detail::lock_waiter* next = nullptr;
+        bool removed = false;
+
+        {
+            const auto guard = guard_();
+            removed = waiters_.remove(waiter);
+            if (removed && !writer_ && readers_ != 0 && !waiters_.empty() && waiters_.front().shared_) {
+                next = hand_over_();
+            }
+        }
+
+        detail::wake(next);
+        return removed;
+    }
+
+    // hands ownership to the next writer or to the run of readers at the front of the queue, linking those woken
+    [[nodiscard]] detail::lock_waiter* hand_over_() noexcept {
+        if (waiters_.empty()) { return nullptr; }
+
+        if (!waiters_.front().shared_) {
+            writer_ = true;
+            return waiters_.pop();
+        }
+
+        detail::lock_waiter* head = nullptr;
+        detail::lock_waiter* tail = nullptr;
+
+        while (!waiters_.empty() && waiters_.front().shared_) {
+            detail::lock_waiter* reader = waiters_.pop();
+            ++readers_;
+
+            if (tail == nullptr) {
+                head = reader;
+            } else {
+                tail->next_ = reader;
+            }
+
+            tail = reader;
+        }
+
+        return head;
+    }
+
+    void release_() noexcept {
+        detail::lock_waiter* next = nullptr;
+
+        {
+            const auto guard = guard_();
+            writer_ = false;
+            next = hand_over_();
+        }
+
+        detail::wake(next);
+    }
+
+    void release_shared_() noexcept {
+        detail::lock_waiter* next = nullptr;
+
+        {
+            const auto guard = guard_();
+            if (--readers_ == 0) { next = hand_over_(); }
+        }
+
+        detail::wake(next);
+    }
+
+    template <typename T, typename G>
+    friend class detail::acquire_awaiter;
+
+    friend class lock_guard<shared_mutex>;
+    friend class shared_lock_guard<shared_mutex>;
+
+   public:
+    shared_mutex& operator=(const shared_mutex& other) = delete;
+    shared_mutex(const shared_mutex& other) = delete;
+
+    shared_mutex() = default;
+};
+
+// the coroutine context is no longer needed, as waiting does not allocate a frame, but is retained for compatibility
+template <typename T>
+[[nodiscard]] detail::acquire_request<T, lock_guard<T>, false> lock(coroutine_context, T& mutex) noexcept {
+    return detail::acquire_request<T, lock_guard<T>, false>(mutex);
+}
+
+[[nodiscard]] inline detail::acquire_request<shared_mutex, shared_lock_guard<shared_mutex>, true> lock_shared(
+    coroutine_context, shared_mutex& mutex) noexcept {
+    return detail::acquire_request<shared_mutex, shared_lock_guard<shared_mutex>, true>(mutex);
+}
+
+[[nodiscard]] inline detail::acquire_request<semaphore, lock_guard<semaphore>, false> acquire(
+    coroutine_context, semaphore& resource) noexcept {
+    return detail::acquire_request<semaphore, lock_guard<semaphore>, false>(resource);
+}
+
 }  // namespace nano
@@ -0,0 +1,64 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+namespace nano {
+
+namespace scheduling {
+
+// Every step scans all contexts, resuming those with a ready frame on top of their stack
+class poll {};
+
+// Every step resumes only the contexts which were signalled ready since the previous step
+class queued {};
+
+// As queued, with each context given one of Classes priorities when handed out (0 being the most urgent). Every step
+// resumes the ready contexts of the most urgent class with any, along with those of any class passed over for Aging
+// steps in a row, so that less urgent classes are delayed but never starved
+template <std::size_t Classes = 2, std::size_t Aging = 16>
+class prioritized {
+    static_assert(Classes > 0 && Aging > 0);
+};
+
+template <typename S>
+inline constexpr bool is_queued_v = !std::is_same_v<S, poll>;
+
+template <typename S>
+inline constexpr bool is_prioritized_v = false;
+
+template <std::size_t Classes, std::size_t Aging>
+inline constexpr bool is_prioritized_v<prioritized<Classes, Aging>> = true;
+
+template <typename S>
+inline constexpr std::size_t class_count_v = 1;
+
+template <std::size_t Classes, std::size_t Aging>
+inline constexpr std::size_t class_count_v<prioritized<Classes, Aging>> = Classes;
+
+template <typename S>
+inline constexpr std::size_t aging_steps_v = 1;
+
+template <std::size_t Classes, std::size_t Aging>
+inline constexpr std::size_t aging_steps_v<prioritized<Classes, Aging>> = Aging;
+
+}  // namespace scheduling
+
+}  // namespace nano
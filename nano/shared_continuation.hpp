@@ -0,0 +1,87 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/broadcast_event.hpp>
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/detail.hpp>
+#include <nano/execution.hpp>
+
+#include <atomic>
+#include <coroutine>
+
+namespace nano {
+
+// a continuation any number of coroutines may await, each reading its result in place by const reference. Every
+// waiter is woken in one pass once it completes
+template <typename T, typename E = execution::eager>
+class shared_continuation {
+   public:
+    using return_type = T;
+
+    using promise_type = detail::coroutine_promise<shared_continuation<T, E>, T, E, detail::broadcast_signal>;
+    class awaiter_type;
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+   private:
+    handle_type handle_;
+
+   public:
+    class awaiter_type {
+       private:
+        detail::broadcast_awaiter waiting_;
+        detail::view<promise_type> promise_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return waiting_.await_ready(); }
+
+        // a coroutine which completed without a result was cancelled
+        [[nodiscard]] const T& await_resume() {
+            const auto& result = promise_.get().get_result();
+            if (!result.has_value()) { throw operation_cancelled(); }
+            return *result;
+        }
+
+        [[nodiscard]] std::coroutine_handle<> await_suspend(std::coroutine_handle<> handle) noexcept {
+            if (!waiting_.await_suspend(handle)) { return handle; }
+            return promise_.get().transfer_target();
+        }
+
+        awaiter_type(detail::signal receiver_signal, promise_type& promise) noexcept
+            : waiting_{receiver_signal, promise.completion()}, promise_{detail::view(promise)} {}
+    };
+
+    // not abandonable, as the coroutine is owned here rather than by any one of its waiters
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) noexcept {
+        return awaiter_type(receiver_signal, handle_.promise());
+    }
+
+    shared_continuation(shared_continuation<T, E>&& other) = delete;
+    shared_continuation(const shared_continuation<T, E>& other) = delete;
+
+    shared_continuation<T, E>& operator=(shared_continuation<T, E>&& other) = delete;
+    shared_continuation<T, E>& operator=(const shared_continuation<T, E>& other) = delete;
+
+    shared_continuation(handle_type coroutine_handle) noexcept : handle_{coroutine_handle} {}
+
+    ~shared_continuation() noexcept { handle_.destroy(); }
+};
+
+}  // namespace nano
@@ -0,0 +1,252 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/detail.hpp>
+#include <nano/execution.hpp>
+#include <nano/executor.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace nano {
+
+// a continuation which may be moved, e.g. into a container. Any coroutine returning a continuation may be converted
+// into a task, and a coroutine may return a task itself
+template <typename T, typename E = execution::eager>
+class task {
+   public:
+    using return_type = T;
+    using promise_type = typename continuation<T, E>::promise_type;
+    using awaiter_type = typename continuation<T, E>::awaiter_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+   private:
+    handle_type handle_{nullptr};
+
+   public:
+    [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(handle_); }
+
+    // an empty task (e.g. default-constructed or released) has nothing left to run, so is done
+    [[nodiscard]] bool done() const noexcept { return !handle_ || handle_.promise().complete(); }
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) {
+        const bool ready = handle_.promise().attach_receiver_signal(receiver_signal, delivered);
+        return awaiter_type{detail::view(handle_.promise()), ready};
+    }
+
+    // hands ownership of the coroutine over (e.g. to a nano::task_group), leaving the task empty
+    [[nodiscard]] handle_type release() noexcept { return std::exchange(handle_, nullptr); }
+
+    task& operator=(const task& other) = delete;
+    task(const task& other) = delete;
+
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) { handle_.destroy(); }
+            handle_ = other.release();
+        }
+
+        return *this;
+    }
+
+    task(task&& other) noexcept : handle_{other.release()} {}
+
+    task(continuation<T, E>&& other) noexcept : handle_{other.release()} {}
+    task(handle_type coroutine_handle) noexcept : handle_{coroutine_handle} {}
+    task() = default;
+
+    ~task() noexcept {
+        if (handle_) { handle_.destroy(); }
+    }
+};
+
+template <typename T, typename E>
+task(continuation<T, E>&&) -> task<T, E>;
+
+namespace detail {
+
+template <typename T, typename E>
+inline constexpr bool is_abandonable_v<task<T, E>> = false;
+
+// a task of any return type owned by a task_group, whose frame is destroyed with it
+class group_task {
+   private:
+    std::coroutine_handle<> handle_;
+    completion_signal* completion_;
+
+   public:
+    [[nodiscard]] bool done() const noexcept { return completion_->complete(); }
+    [[nodiscard]] completion_signal& completion() noexcept { return *completion_; }
+
+    group_task& operator=(const group_task& other) = delete;
+    group_task(const group_task& other) = delete;
+
+    group_task& operator=(group_task&& other) noexcept {
+        std::swap(handle_, other.handle_);
+        std::swap(completion_, other.completion_);
+        return *this;
+    }
+
+    group_task(group_task&& other) noexcept
+        : handle_{std::exchange(other.handle_, nullptr)}, completion_{other.completion_} {}
+
+    template <typename T, typename E>
+    explicit group_task(task<T, E>&& owned) noexcept {
+        const auto coroutine_handle = owned.release();
+        handle_ = coroutine_handle;
+        completion_ = &coroutine_handle.promise().completion();
+    }
+
+    ~group_task() noexcept {
+        if (handle_) { handle_.destroy(); }
+    }
+};
+
+}  // namespace detail
+
+// spawns coroutines onto free contexts of an executor X and owns them, destroying the frames of finished ones (so that
+// their contexts may be handed out again) whenever a context is needed and periodically as tasks are spawned. Its
+// tasks must be complete (e.g. once joined) by the time the group is destroyed
+template <typename X>
+class task_group {
+   private:
+    static constexpr std::size_t min_reclaim_threshold = 16;
+
+    X* executor_;
+    cancellation_token token_;
+    std::vector<detail::group_task> tasks_{};
+    std::size_t reclaim_threshold_{min_reclaim_threshold};
+
+    // amortized: reclaiming is only repeated once the group has doubled in size
+    void reclaim_() noexcept {
+        std::erase_if(tasks_, [](const detail::group_task& owned) { return owned.done(); });
+        reclaim_threshold_ = std::max(min_reclaim_threshold, 2 * tasks_.size());
+    }
+
+    [[nodiscard]] std::optional<coroutine_context> find_context_() noexcept {
+        std::optional<coroutine_context> context = executor_->try_find_available_context();
+        if (!context.has_value()) {
+            reclaim_();
+            context = executor_->try_find_available_context();
+        }
+
+        if (!context.has_value()) { return std::nullopt; }
+        return context->with_cancellation(token_);
+    }
+
+   public:
+    class join_request {
+       private:
+        task_group* group_;
+
+       public:
+        // every task spawned before joining is attached to a countdown, with an extra arrival made once all of them are
+        // attached. Tasks spawned meanwhile are left to the next join
+        class awaiter_type {
+           private:
+            task_group* group_;
+            detail::countdown countdown_;
+            bool ready_;
+
+            [[nodiscard]] bool attached_() noexcept {
+                for (detail::group_task& owned : group_->tasks_) {
+                    if (owned.completion().attach(countdown_.arrival_signal())) {
+                        static_cast<void>(countdown_.arrive());
+                    }
+                }
+
+                return countdown_.arrive();
+            }
+
+           public:
+            [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+            constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+            void await_resume() noexcept { group_->reclaim_(); }
+
+            awaiter_type& operator=(const awaiter_type& other) = delete;
+            awaiter_type(const awaiter_type& other) = delete;
+
+            awaiter_type(detail::signal receiver_signal, task_group& group) noexcept
+                : group_{&group},
+                  countdown_{static_cast<std::int64_t>(group.tasks_.size()) + 1, detail::cleared(receiver_signal)},
+                  ready_{attached_()} {}
+        };
+
+        [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) noexcept {
+            return awaiter_type(receiver_signal, *group_);
+        }
+
+        explicit join_request(task_group& group) noexcept : group_{&group} {}
+    };
+
+    // f is invoked with a free context and args, returning a task or continuation. Returns false, without invoking f,
+    // when no context is free even once finished tasks are reclaimed
+    template <typename F, typename... Args>
+    [[nodiscard]] bool try_spawn(F&& f, Args&&... args) {
+        if (tasks_.size() >= reclaim_threshold_) { reclaim_(); }
+
+        const std::optional<coroutine_context> context = find_context_();
+        if (!context.has_value()) { return false; }
+
+        tasks_.emplace_back(task(std::invoke(std::forward<F>(f), *context, std::forward<Args>(args)...)));
+        return true;
+    }
+
+    // terminates if no context is free
+    template <typename F, typename... Args>
+    void spawn(F&& f, Args&&... args) {
+        if (!try_spawn(std::forward<F>(f), std::forward<Args>(args)...)) { std::terminate(); }
+    }
+
+    // completes once every task spawned before it has, reclaiming them. A group is joined by one coroutine at a time
+    [[nodiscard]] join_request join() noexcept { return join_request(*this); }
+
+    // destroys the frames of finished tasks now rather than once a context is needed, returning how many there were
+    std::size_t reclaim() noexcept {
+        const std::size_t size = tasks_.size();
+        reclaim_();
+        return size - tasks_.size();
+    }
+
+    [[nodiscard]] bool has_finished() const noexcept {
+        return std::any_of(tasks_.begin(), tasks_.end(), [](const detail::group_task& owned) { return owned.done(); });
+    }
+
+    // the number of tasks owned, some of which may have finished without being reclaimed yet
+    [[nodiscard]] std::size_t size() const noexcept { return tasks_.size(); }
+
+    task_group& operator=(const task_group& other) = delete;
+    task_group(const task_group& other) = delete;
+
+    // each context handed to a task carries token, so that the whole group may be cancelled at once
+    explicit task_group(X& executor, const cancellation_token token = {}) noexcept
+        : executor_{&executor}, token_{token} {}
+};
+
+}  // namespace nano
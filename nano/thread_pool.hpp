@@ -0,0 +1,197 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+#include <nano/mutex.hpp>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace nano {
+
+namespace detail {
+
+// a job queued on a thread_pool, living in the awaiter of the frame which offloaded it
+struct pool_job {
+    void (*run_)(void*) noexcept {nullptr};
+    void* target_{nullptr};
+    pool_job* next_{nullptr};
+};
+
+}  // namespace detail
+
+// N worker threads running functions offloaded by coroutines, so that heavy computation doesn't stall the executor
+// their contexts belong to. Jobs are queued intrusively in the awaiters of the offloading frames, so offloading
+// allocates nothing. Jobs still queued when the pool is destroyed are run first
+template <std::size_t N>
+class thread_pool {
+   private:
+    static_assert(N > 0);
+
+    detail::spin_lock lock_{};
+    detail::basic_waiter_queue<detail::pool_job> jobs_{};
+    std::atomic_bool stopping_{false};
+    detail::parker parker_{};
+    std::array<std::jthread, N> workers_{};
+
+    [[nodiscard]] std::unique_lock<detail::spin_lock> guard_() noexcept {
+        return std::unique_lock<detail::spin_lock>(lock_);
+    }
+
+    [[nodiscard]] bool has_job_() noexcept {
+        const auto guard = guard_();
+        return !jobs_.empty();
+    }
+
+    [[nodiscard]] detail::pool_job* try_pop_() noexcept {
+        const auto guard = guard_();
+        return jobs_.empty() ? nullptr : jobs_.pop();
+    }
+
+    void work_() noexcept {
+        for (;;) {
+            if (detail::pool_job* const job = try_pop_(); job != nullptr) {
+                job->run_(job->target_);
+                continue;
+            }
+
+            if (stopping_.load(std::memory_order_seq_cst)) { return; }
+            parker_.park([this] { return has_job_() || stopping_.load(std::memory_order_seq_cst); }, std::nullopt);
+        }
+    }
+
+   public:
+    static constexpr std::size_t worker_count = N;
+
+    // the job must stay in place until it has run
+    void submit(detail::pool_job& job) noexcept {
+        {
+            const auto guard = guard_();
+            jobs_.push(job);
+        }
+
+        parker_.unpark();
+    }
+
+    thread_pool<N>& operator=(const thread_pool<N>& other) = delete;
+    thread_pool(const thread_pool<N>& other) = delete;
+
+    thread_pool() {
+        for (auto& worker : workers_) { worker = std::jthread([this] { work_(); }); }
+    }
+
+    ~thread_pool() noexcept {
+        stopping_.store(true, std::memory_order_seq_cst);
+        parker_.unpark_all();
+        for (auto& worker : workers_) { worker.join(); }
+    }
+};
+
+namespace detail {
+
+template <std::size_t N, typename F>
+class offload_request {
+   private:
+    using result_type = std::invoke_result_t<F&>;
+    using stored_type = std::conditional_t<std::is_void_v<result_type>, std::monostate, result_type>;
+
+    thread_pool<N>* pool_;
+    F function_;
+
+   public:
+    // the result is stored in the awaiter, in the offloading frame, and published by the seq_cst store which sets the
+    // frame ready. The coroutine then continues on the executor its context belongs to
+    class awaiter_type {
+       private:
+        thread_pool<N>* pool_;
+        F function_;
+        signal receiver_signal_;
+        pool_job job_{};
+
+        std::optional<stored_type> result_{std::nullopt};
+        std::exception_ptr exception_{nullptr};
+
+        // runs on a worker. The signal is copied first, as the frame may be destroyed as soon as it is set
+        static void run_(void* target) noexcept {
+            awaiter_type& self = *static_cast<awaiter_type*>(target);
+
+            try {
+                if constexpr (std::is_void_v<result_type>) {
+                    std::invoke(self.function_);
+                    self.result_.emplace();
+                } else {
+                    self.result_.emplace(std::invoke(self.function_));
+                }
+            } catch (...) { self.exception_ = std::current_exception(); }
+
+            const signal receiver_signal = self.receiver_signal_;
+            receiver_signal.set(true);
+        }
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return false; }
+
+        // queued once suspended, when the awaiter's address is final
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            job_.run_ = &run_;
+            job_.target_ = this;
+            pool_->submit(job_);
+        }
+
+        result_type await_resume() {
+            if (exception_ != nullptr) { std::rethrow_exception(exception_); }
+            if constexpr (!std::is_void_v<result_type>) { return std::move(*result_); }
+        }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(signal receiver_signal, thread_pool<N>& pool, F&& function)
+            : pool_{&pool}, function_{std::move(function)}, receiver_signal_{receiver_signal} {
+            receiver_signal.set(false);
+        }
+    };
+
+    // not abandonable, as a job can't be withdrawn once a worker has started it
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal) {
+        return awaiter_type(receiver_signal, *pool_, std::move(function_));
+    }
+
+    offload_request(thread_pool<N>& pool, F&& function) : pool_{&pool}, function_{std::move(function)} {}
+};
+
+}  // namespace detail
+
+// awaiting it runs function on one of the pool's workers, yielding its result (or rethrowing what it threw)
+template <std::size_t N, typename F>
+[[nodiscard]] detail::offload_request<N, std::decay_t<F>> offload(thread_pool<N>& pool, F&& function) {
+    return detail::offload_request<N, std::decay_t<F>>(pool, std::decay_t<F>(std::forward<F>(function)));
+}
+
+}  // namespace nano
@@ -0,0 +1,385 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace nano {
+
+namespace detail {
+
+using clock = std::chrono::steady_clock;
+
+// intrusive entry of a timer_wheel, living in the awaiter of a suspended coroutine
+struct timer_node {
+    timer_node* prev_{nullptr};
+    timer_node* next_{nullptr};
+    timer_node** head_{nullptr};
+    std::uint64_t tick_{0};
+    signal signal_{signal::make_detached()};
+
+    // set (if provided) once the timer has expired and is no longer accessed, as for an abandonable awaiter
+    std::atomic_bool* delivered_{nullptr};
+
+    [[nodiscard]] constexpr bool linked() const noexcept { return head_ != nullptr; }
+};
+
+// hierarchical timing wheel of 1 ms ticks. Four levels of 64 slots cover ~4.7 hours ahead, beyond which timers wait in
+// an overflow list. Inserting and cancelling a timer is O(1), and a timer moves down at most once per level
+class timer_wheel {
+   public:
+    using duration = std::chrono::milliseconds;
+
+   private:
+    static constexpr std::size_t level_bits = 6;
+    static constexpr std::size_t level_count = 4;
+    static constexpr std::size_t slot_count = std::size_t{1} << level_bits;
+    static constexpr std::uint64_t slot_mask = slot_count - 1;
+    static constexpr std::uint64_t horizon = std::uint64_t{1} << (level_bits * level_count);
+
+    clock::time_point origin_;
+    clock::time_point now_;
+    bool cached_{false};
+    std::uint64_t current_{0};
+    std::size_t pending_{0};
+
+    std::array<std::array<timer_node*, slot_count>, level_count> slots_{};
+    timer_node* overflow_{nullptr};
+
+    bool concurrent_;
+    spin_lock lock_;
+
+    [[nodiscard]] std::unique_lock<spin_lock> guard_() noexcept {
+        return concurrent_ ? std::unique_lock<spin_lock>(lock_) : std::unique_lock<spin_lock>();
+    }
+
+    // deadlines round up to the next tick so that a timer never expires early
+    [[nodiscard]] std::uint64_t deadline_tick_(const clock::time_point deadline) const noexcept {
+        if (deadline <= origin_) { return 0; }
+        return static_cast<std::uint64_t>(std::chrono::ceil<duration>(deadline - origin_).count());
+    }
+
+    [[nodiscard]] std::uint64_t elapsed_tick_(const clock::time_point now) const noexcept {
+        if (now <= origin_) { return 0; }
+        return static_cast<std::uint64_t>(std::chrono::floor<duration>(now - origin_).count());
+    }
+
+    [[nodiscard]] clock::time_point time_of_(const std::uint64_t tick) const noexcept {
+        return origin_ + duration(static_cast<duration::rep>(tick));
+    }
+
+    // the highest 6-bit group in which a tick differs from the current tick selects its level, so that its slot is
+    // reached (and cascaded to a lower level) before it expires
+    [[nodiscard]] timer_node*& head_for_(const std::uint64_t tick) noexcept {
+        const std::uint64_t differing = tick ^ current_;
+        if (differing >= horizon) { return overflow_; }
+
+        std::size_t level = 0;
+        while ((differing >> (level_bits * (level + 1))) != 0) { ++level; }
+
+        return slots_[level][(tick >> (level_bits * level)) & slot_mask];
+    }
+
+    static void link_(timer_node& node, timer_node*& head) noexcept {
+        node.prev_ = nullptr;
+        node.next_ = head;
+        node.head_ = &head;
+        if (head != nullptr) { head->prev_ = &node; }
+        head = &node;
+    }
+
+    static void unlink_(timer_node& node) noexcept {
+        if (node.prev_ != nullptr) {
+            node.prev_->next_ = node.next_;
+        } else {
+            *node.head_ = node.next_;
+        }
+
+        if (node.next_ != nullptr) { node.next_->prev_ = node.prev_; }
+
+        node.prev_ = nullptr;
+        node.next_ = nullptr;
+        node.head_ = nullptr;
+    }
+
+    void cascade_(timer_node*& head) noexcept {
+        timer_node* node = std::exchange(head, nullptr);
+
+        while (node != nullptr) {
+            timer_node* next = node->next_;
+            link_(*node, head_for_(node->tick_));
+            node = next;
+        }
+    }
+
+    void expire_(timer_node*& head) noexcept {
+        while (head != nullptr) {
+            timer_node& node = *head;
+            unlink_(node);
+            --pending_;
+
+            // copied first, as the awaiting coroutine may be resumed (on another thread) as soon as it is signalled
+            const signal expired = node.signal_;
+            std::atomic_bool* const delivered = node.delivered_;
+            expired.set(true);
+            if (delivered != nullptr) { delivered->store(true, std::memory_order_release); }
+        }
+    }
+
+    void advance_(const clock::time_point now) noexcept {
+        now_ = now;
+        if (!concurrent_) { cached_ = true; }
+        const std::uint64_t target = elapsed_tick_(now);
+
+        while (current_ < target) {
+            if (pending_ == 0) {
+                current_ = target;
+                return;
+            }
+
+            ++current_;
+            if ((current_ & (horizon - 1)) == 0) { cascade_(overflow_); }
+
+            for (std::size_t level = level_count - 1; level > 0; --level) {
+                const std::size_t shift = level_bits * level;
+                if ((current_ & ((std::uint64_t{1} << shift) - 1)) != 0) { continue; }
+                cascade_(slots_[level][(current_ >> shift) & slot_mask]);
+            }
+
+            expire_(slots_[0][current_ & slot_mask]);
+        }
+    }
+
+   public:
+    // the time sampled by the ongoing step of a single-threaded executor, saving a clock read per timer. Otherwise, the
+    // clock is read directly
+    [[nodiscard]] clock::time_point now() const noexcept { return cached_ ? now_ : clock::now(); }
+
+    void end_step() noexcept { cached_ = false; }
+
+    // returns false, leaving the timer unlinked, when the deadline has already passed
+    [[nodiscard]] bool insert(timer_node& node, const clock::time_point deadline) noexcept {
+        const auto guard = guard_();
+        const std::uint64_t tick = deadline_tick_(deadline);
+        if (tick <= current_) { return false; }
+
+        node.tick_ = tick;
+        link_(node, head_for_(tick));
+        ++pending_;
+        return true;
+    }
+
+    // a timer which expired concurrently has already been signalled once this returns
+    void cancel(timer_node& node) noexcept {
+        const auto guard = guard_();
+        if (!node.linked()) { return; }
+
+        unlink_(node);
+        --pending_;
+    }
+
+    // expires every timer due by now, signalling the coroutines awaiting them. Concurrent callers don't wait on one
+    // another: whoever holds the wheel advances it on behalf of the rest
+    void advance(const clock::time_point now) noexcept {
+        if (!concurrent_) {
+            advance_(now);
+            return;
+        }
+
+        const std::unique_lock<spin_lock> guard(lock_, std::try_to_lock);
+        if (guard.owns_lock()) { advance_(now); }
+    }
+
+    // the earliest time at which a timer may expire or move down a level, std::nullopt if no timers are pending
+    [[nodiscard]] std::optional<clock::time_point> next_expiry() noexcept {
+        const auto guard = guard_();
+        if (pending_ == 0) { return std::nullopt; }
+
+        for (std::size_t level = 0; level < level_count; ++level) {
+            const std::size_t shift = level_bits * level;
+            const std::uint64_t base = (current_ >> (shift + level_bits)) << (shift + level_bits);
+
+            for (std::uint64_t index = ((current_ >> shift) & slot_mask) + 1; index < slot_count; ++index) {
+                if (slots_[level][index] != nullptr) { return time_of_(base + (index << shift)); }
+            }
+        }
+
+        return time_of_((current_ / horizon + 1) * horizon);
+    }
+
+    timer_wheel& operator=(const timer_wheel& other) = delete;
+    timer_wheel(const timer_wheel& other) = delete;
+
+    explicit timer_wheel(const bool concurrent = false) noexcept
+        : origin_{clock::now()}, now_{origin_}, concurrent_{concurrent} {}
+};
+
+[[nodiscard]] inline timer_wheel* wheel_of(const signal receiver_signal) noexcept {
+    return receiver_signal.node_ != nullptr ? receiver_signal.node_->wheel_ : nullptr;
+}
+
+// suspends the receiver until a deadline, which it only learns of once the deadline's timer expires. Abandoning it
+// (as on cancellation) removes the timer from the wheel, so that a long sleep doesn't hold its context
+class sleep_awaiter {
+   private:
+    timer_wheel* wheel_;
+    timer_node timer_{};
+    clock::time_point deadline_;
+    bool ready_;
+
+   public:
+    [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+
+    // a deadline which passed before the timer was inserted is reported as ready, the timer never being delivered
+    [[nodiscard]] bool await_suspend(std::coroutine_handle<>) noexcept {
+        if (wheel_->insert(timer_, deadline_)) { return true; }
+
+        ready_ = true;
+        return false;
+    }
+
+    constexpr void await_resume() const noexcept {}
+
+    // once the timer is cancelled, it is either withdrawn or has already expired and been delivered, so it is never
+    // accessed again. A sleep has no result to lose, so it is always reported as withdrawn
+    [[nodiscard]] bool detach() noexcept {
+        if (wheel_ != nullptr) { wheel_->cancel(timer_); }
+        return true;
+    }
+
+    sleep_awaiter& operator=(const sleep_awaiter& other) = delete;
+    sleep_awaiter(const sleep_awaiter& other) = delete;
+
+    // outside of an executor there is no wheel to wait on, so the deadline is considered passed
+    sleep_awaiter(signal receiver_signal, timer_wheel* wheel, const clock::time_point deadline,
+                  std::atomic_bool* delivered = nullptr) noexcept
+        : wheel_{wheel}, deadline_{deadline}, ready_{wheel == nullptr || deadline <= wheel->now()} {
+        timer_.signal_ = receiver_signal;
+        timer_.delivered_ = delivered;
+        if (!ready_) { receiver_signal.set(false); }
+    }
+};
+
+}  // namespace detail
+
+class sleep_until {
+   private:
+    detail::clock::time_point deadline_;
+
+   public:
+    using awaiter_type = detail::sleep_awaiter;
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) noexcept {
+        return awaiter_type(receiver_signal, detail::wheel_of(receiver_signal), deadline_, delivered);
+    }
+
+    explicit sleep_until(const detail::clock::time_point deadline) noexcept : deadline_{deadline} {}
+};
+
+// measured from the time sampled at the start of the executor's current step
+class sleep_for {
+   private:
+    detail::clock::duration duration_;
+
+   public:
+    using awaiter_type = detail::sleep_awaiter;
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal, std::atomic_bool* delivered = nullptr) noexcept {
+        detail::timer_wheel* wheel = detail::wheel_of(receiver_signal);
+        const auto now = wheel != nullptr ? wheel->now() : detail::clock::now();
+        return awaiter_type(receiver_signal, wheel, now + duration_, delivered);
+    }
+
+    template <typename Rep, typename Period>
+    explicit sleep_for(const std::chrono::duration<Rep, Period> duration) noexcept
+        : duration_{std::chrono::duration_cast<detail::clock::duration>(duration)} {}
+};
+
+// Awaits an event or continuation for at most the given duration, yielding std::nullopt once it elapses. A timed out
+// event or continuation is left intact and may be awaited again.
+template <typename A>
+class timeout {
+   private:
+    using inner_awaiter_type = typename A::awaiter_type;
+    using value_type = std::decay_t<decltype(std::declval<inner_awaiter_type&>().await_resume())>;
+
+    A& awaitable_;
+    detail::clock::duration duration_;
+
+   public:
+    class awaiter_type {
+       private:
+        std::atomic_bool delivered_{false};
+        inner_awaiter_type inner_;
+
+        detail::timer_wheel* wheel_;
+        detail::timer_node timer_{};
+        detail::clock::time_point deadline_;
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return inner_.await_ready(); }
+
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<>) noexcept {
+            return wheel_ == nullptr || wheel_->insert(timer_, deadline_);
+        }
+
+        // whichever of the timer and the awaitable signalled the receiver, the other is withdrawn before returning so
+        // that it can't signal the receiver once it has moved on. Throws when the awaitable's result does (e.g. as it
+        // was cancelled)
+        [[nodiscard]] std::optional<value_type> await_resume() {
+            if (inner_.await_ready()) { return inner_.await_resume(); }
+            if (wheel_ != nullptr) { wheel_->cancel(timer_); }
+            if (inner_.detach()) { return std::nullopt; }
+
+            while (!delivered_.load(std::memory_order_acquire)) {}
+            return inner_.await_resume();
+        }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(A& awaitable, detail::signal receiver_signal, detail::timer_wheel* wheel,
+                     const detail::clock::time_point deadline) noexcept
+            : inner_{awaitable.awaiter(receiver_signal, &delivered_)}, wheel_{wheel}, deadline_{deadline} {
+            timer_.signal_ = receiver_signal;
+        }
+    };
+
+    [[nodiscard]] awaiter_type awaiter(detail::signal receiver_signal) noexcept {
+        detail::timer_wheel* wheel = detail::wheel_of(receiver_signal);
+        const auto now = wheel != nullptr ? wheel->now() : detail::clock::now();
+        return awaiter_type(awaitable_, receiver_signal, wheel, now + duration_);
+    }
+
+    template <typename Rep, typename Period>
+    timeout(A& awaitable, const std::chrono::duration<Rep, Period> duration) noexcept
+        : awaitable_{awaitable}, duration_{std::chrono::duration_cast<detail::clock::duration>(duration)} {}
+};
+
+}  // namespace nano
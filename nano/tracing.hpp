@@ -0,0 +1,116 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace nano {
+
+namespace tracing {
+
+// No instrumentation is compiled in
+class none {};
+
+// Every resume of a context is timed and counted, and the most recent Spans resumes are kept for export as a Chrome
+// trace (loadable in Perfetto or chrome://tracing)
+template <std::size_t Spans = 65536>
+class enabled {};
+
+template <typename T>
+inline constexpr bool is_enabled_v = !std::is_same_v<T, none>;
+
+// Contexts only count spawns and completions and timestamp their wake-ups (as tracing::enabled needs) when
+// NANO_TRACING is defined before any nano header is included, so that untraced builds pay nothing for the hooks
+#ifdef NANO_TRACING
+inline constexpr bool hooks_v = true;
+#else
+inline constexpr bool hooks_v = false;
+#endif
+
+// durations bucketed by powers of two: bucket i counts durations of [2^(i-1), 2^i) nanoseconds
+class histogram {
+   public:
+    static constexpr std::size_t bucket_count = 64;
+
+   private:
+    std::array<std::uint64_t, bucket_count> buckets_{};
+    std::uint64_t count_{0};
+
+   public:
+    [[nodiscard]] constexpr std::uint64_t count() const noexcept { return count_; }
+    [[nodiscard]] constexpr std::uint64_t bucket(const std::size_t index) const noexcept { return buckets_[index]; }
+
+    // an upper bound of the q-th quantile, to within a factor of two
+    [[nodiscard]] constexpr std::chrono::nanoseconds quantile(const double q) const noexcept {
+        const auto target = static_cast<std::uint64_t>(q * static_cast<double>(count_));
+        std::uint64_t seen = 0;
+
+        for (std::size_t index = 0; index + 1 < bucket_count; ++index) {
+            seen += buckets_[index];
+            if (seen > target || seen == count_) { return std::chrono::nanoseconds{(std::int64_t{1} << index) - 1}; }
+        }
+
+        return std::chrono::nanoseconds::max();
+    }
+
+    constexpr void record(const std::chrono::nanoseconds duration) noexcept {
+        const auto ticks = static_cast<std::uint64_t>(std::max(duration.count(), std::int64_t{0}));
+        ++buckets_[std::min<std::size_t>(std::bit_width(ticks), bucket_count - 1)];
+        ++count_;
+    }
+};
+
+// per context: how often and for how long it ran between suspensions, and how long it waited to be resumed after its
+// frame was signalled ready
+struct context_counters {
+    std::uint64_t resumes{0};
+    std::uint64_t spawns{0};
+    std::uint64_t completions{0};
+
+    std::chrono::nanoseconds run_time{0};
+    std::chrono::nanoseconds max_run_time{0};
+
+    histogram run_times{};
+    histogram wake_latencies{};
+};
+
+// per executor: how many steps resumed nothing, and how many contexts the busiest step resumed
+struct step_counters {
+    std::uint64_t steps{0};
+    std::uint64_t idle_steps{0};
+    std::uint64_t resumes{0};
+    std::uint64_t max_resumes_per_step{0};
+};
+
+// a single resume of a context, timed from the executor's clock epoch
+struct span {
+    std::size_t context;
+    std::chrono::nanoseconds start;
+    std::chrono::nanoseconds end;
+    std::chrono::nanoseconds wake_latency;
+};
+
+}  // namespace tracing
+
+}  // namespace nano
@@ -0,0 +1,185 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <nano/detail.hpp>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace nano {
+
+namespace detail {
+
+template <typename A>
+using awaited_value_t = std::decay_t<decltype(std::declval<typename A::awaiter_type&>().await_resume())>;
+
+// the awaitables are attached to a countdown which signals the receiver once all of them are complete
+template <typename... A>
+class when_all_request {
+   private:
+    std::tuple<A*...> awaitables_;
+
+   public:
+    class awaiter_type {
+       private:
+        countdown countdown_;
+        std::tuple<typename A::awaiter_type...> inner_;
+        bool ready_;
+
+        // an extra arrival, made once every awaitable is attached, keeps the countdown from completing before then
+        [[nodiscard]] bool attached_() noexcept {
+            const auto arrive_if_ready = [this](auto& inner) {
+                if (inner.await_ready()) { static_cast<void>(countdown_.arrive()); }
+            };
+
+            std::apply([&arrive_if_ready](auto&... inner) { (arrive_if_ready(inner), ...); }, inner_);
+            return countdown_.arrive();
+        }
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+        constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+        // throws the first exception (e.g. operation_cancelled) thrown by the awaitables' results
+        [[nodiscard]] std::tuple<awaited_value_t<A>...> await_resume() {
+            return std::apply([](auto&... inner) { return std::tuple<awaited_value_t<A>...>(inner.await_resume()...); },
+                              inner_);
+        }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(signal receiver_signal, A*... awaitables) noexcept
+            : countdown_{static_cast<std::int64_t>(sizeof...(A)) + 1, cleared(receiver_signal)},
+              inner_{awaitables->awaiter(countdown_.arrival_signal())...},
+              ready_{attached_()} {}
+    };
+
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal) noexcept {
+        return std::apply([receiver_signal](A*... awaitables) { return awaiter_type(receiver_signal, awaitables...); },
+                          awaitables_);
+    }
+
+    explicit when_all_request(A&... awaitables) noexcept : awaitables_{&awaitables...} {}
+};
+
+// the awaitables are attached to a countdown which signals the receiver once any of them is complete, after which the
+// others are withdrawn
+template <typename... A>
+class when_any_request {
+   private:
+    std::tuple<A*...> awaitables_;
+
+   public:
+    using value_type = std::variant<awaited_value_t<A>...>;
+
+    class awaiter_type {
+       private:
+        std::array<std::atomic_bool, sizeof...(A)> delivered_{};
+        countdown countdown_;
+        std::tuple<typename A::awaiter_type...> inner_;
+        bool ready_;
+
+        [[nodiscard]] bool attached_() noexcept {
+            const bool any_ready = std::apply([](auto&... inner) { return (inner.await_ready() || ...); }, inner_);
+            return any_ready || countdown_.arrive();
+        }
+
+        // withdraws the awaitable unless it completed, in which case its result may be taken once delivered
+        template <std::size_t I>
+        [[nodiscard]] bool settle_() noexcept {
+            auto& inner = std::get<I>(inner_);
+            if (inner.await_ready()) { return true; }
+            if (inner.detach()) { return false; }
+
+            while (!delivered_[I].load(std::memory_order_acquire)) {}
+            return true;
+        }
+
+        template <std::size_t... I>
+        [[nodiscard]] value_type resume_(std::index_sequence<I...>) {
+            std::array<bool, sizeof...(A)> complete{settle_<I>()...};
+
+            std::size_t winner = 0;
+            while (!complete[winner]) { ++winner; }
+
+            std::optional<value_type> result{};
+            const auto take_if_winner = [this, winner, &result]<std::size_t J>(std::integral_constant<std::size_t, J>) {
+                if (J == winner) { result.emplace(std::in_place_index<J>, std::get<J>(inner_).await_resume()); }
+            };
+
+            (take_if_winner(std::integral_constant<std::size_t, I>{}), ...);
+            return std::move(result).value();
+        }
+
+        template <std::size_t... I>
+        awaiter_type(signal receiver_signal, std::tuple<A*...> awaitables, std::index_sequence<I...>) noexcept
+            : countdown_{2, cleared(receiver_signal)},
+              inner_{std::get<I>(awaitables)->awaiter(countdown_.arrival_signal(), &delivered_[I])...},
+              ready_{attached_()} {}
+
+       public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return ready_; }
+        constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+        // the lowest indexed awaitable found complete once resumed, throwing when its result does (e.g. as it was
+        // cancelled)
+        [[nodiscard]] value_type await_resume() { return resume_(std::index_sequence_for<A...>{}); }
+
+        awaiter_type& operator=(const awaiter_type& other) = delete;
+        awaiter_type(const awaiter_type& other) = delete;
+
+        awaiter_type(signal receiver_signal, std::tuple<A*...> awaitables) noexcept
+            : awaiter_type(receiver_signal, awaitables, std::index_sequence_for<A...>{}) {}
+    };
+
+    [[nodiscard]] awaiter_type awaiter(signal receiver_signal) noexcept {
+        return awaiter_type(receiver_signal, awaitables_);
+    }
+
+    explicit when_any_request(A&... awaitables) noexcept : awaitables_{&awaitables...} {}
+};
+
+}  // namespace detail
+
+// Awaits every event or continuation, each of which should run on a context of its own, yielding a tuple of their
+// results. The awaiting coroutine is only signalled once, when the last of them completes
+template <typename... A>
+[[nodiscard]] detail::when_all_request<std::remove_reference_t<A>...> when_all(A&&... awaitables) noexcept {
+    static_assert(sizeof...(A) > 0);
+    return detail::when_all_request<std::remove_reference_t<A>...>(awaitables...);
+}
+
+// Awaits the first of the events or continuations to complete, yielding its result in a variant whose index() is that
+// of the awaitable. The others are left intact, still running, and may be awaited again
+template <typename... A>
+[[nodiscard]] detail::when_any_request<A...> when_any(A&... awaitables) noexcept {
+    static_assert(sizeof...(A) > 0);
+    return detail::when_any_request<A...>(awaitables...);
+}
+
+}  // namespace nano
@@ -0,0 +1,262 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <nano/detail.hpp>
+#include <nano/executor.hpp>
+#include <nano/idle.hpp>
+#include <nano/overflow.hpp>
+#include <nano/timer.hpp>
+#include <optional>
+#include <thread>
+
+namespace nano {
+
+namespace detail {
+
+// bounded Chase-Lev deque: the owning worker pushes and pops at the bottom while other workers steal from the top. A
+// context is held by at most one queue at a time, so a capacity of N contexts can never overflow
+template <std::size_t N>
+class work_stealing_deque {
+   private:
+    static constexpr std::size_t capacity = std::bit_ceil(N);
+    static constexpr std::size_t mask = capacity - 1;
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::array<std::atomic<context_node*>, capacity> slots_{};
+
+    [[nodiscard]] std::atomic<context_node*>& slot_(const std::int64_t index) noexcept {
+        return slots_[static_cast<std::size_t>(index) & mask];
+    }
+
+   public:
+    [[nodiscard]] bool empty() const noexcept {
+        return top_.load(std::memory_order_seq_cst) >= bottom_.load(std::memory_order_seq_cst);
+    }
+
+    void push(context_node& node) noexcept {
+        const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        slot_(bottom).store(&node, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] context_node* pop() noexcept {
+        const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_seq_cst);
+        std::int64_t top = top_.load(std::memory_order_seq_cst);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_release);
+            return nullptr;
+        }
+
+        context_node* node = slot_(bottom).load(std::memory_order_relaxed);
+        if (top != bottom) { return node; }
+
+        // the last element is contended with thieves
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            node = nullptr;
+        }
+
+        bottom_.store(bottom + 1, std::memory_order_release);
+        return node;
+    }
+
+    [[nodiscard]] context_node* steal() noexcept {
+        std::int64_t top = top_.load(std::memory_order_seq_cst);
+        const std::int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+
+        if (top >= bottom) { return nullptr; }
+
+        context_node* node = slot_(top).load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return node;
+    }
+};
+
+}  // namespace detail
+
+// Runs coroutines on Threads workers. Each worker owns a deque of runnable contexts, refilled from a shared queue of
+// newly signalled contexts and, once both are empty, by stealing from its peers. A context (and therefore every frame
+// on its stack) may migrate between workers, but never runs on two workers at once. Eager coroutines spawned from
+// outside of the context they are spawned onto start on a worker rather than inline. Workers without work idle
+// according to I.
+template <typename B, std::size_t N, std::size_t Threads, typename I = idle::adaptive<>,
+          typename O = overflow::terminate>
+class work_stealing_executor {
+   private:
+    static_assert(Threads > 0);
+
+    static constexpr std::size_t context_stack_count = N;
+    static constexpr std::size_t worker_count = Threads;
+    using buffer_type = B;
+
+    detail::context_array<B, N> contexts_;
+    std::array<detail::work_stealing_deque<N>, Threads> deques_;
+    detail::ready_queue injector_;
+    detail::context_pool pool_{true};
+    detail::parker parker_;
+    detail::timer_wheel wheel_{true};
+
+    [[nodiscard]] bool execution_complete_() const noexcept { return pool_.live_count() == 0; }
+
+    [[nodiscard]] detail::context_node* find_work_(const std::size_t worker) noexcept {
+        auto& local = deques_[worker];
+        if (detail::context_node* node = local.pop(); node != nullptr) { return node; }
+
+        // contexts signalled since the last visit are moved onto the local deque where idle peers may steal them
+        if (detail::context_node* node = injector_.take_all(); node != nullptr) {
+            if (node->next_ == nullptr) { return node; }
+
+            for (detail::context_node* rest = node->next_; rest != nullptr;) {
+                detail::context_node* next = rest->next_;
+                local.push(*rest);
+                rest = next;
+            }
+
+            // a parked peer is woken to share the batch
+            parker_.unpark();
+            return node;
+        }
+
+        for (std::size_t offset = 1; offset < worker_count; ++offset) {
+            auto& victim = deques_[(worker + offset) % worker_count];
+            if (detail::context_node* node = victim.steal(); node != nullptr) { return node; }
+        }
+
+        return nullptr;
+    }
+
+    [[nodiscard]] bool has_queued_context_() const noexcept {
+        if (!injector_.empty()) { return true; }
+
+        for (const auto& deque : deques_) {
+            if (!deque.empty()) { return true; }
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] bool has_work_() const noexcept { return execution_complete_() || has_queued_context_(); }
+
+    void work_(const std::size_t worker) noexcept {
+        detail::backoff<I> backoff{};
+
+        // contexts still queued by signals which arrived as their last frame completed are run once more, so that
+        // they may be handed out again as soon as their coroutines are destroyed
+        while (!execution_complete_() || has_queued_context_()) {
+            wheel_.advance(detail::clock::now());
+            detail::context_node* node = find_work_(worker);
+
+            if (node == nullptr) {
+                backoff.idle(parker_, [this] { return has_work_(); }, [this] { return wheel_.next_expiry(); });
+                continue;
+            }
+
+            backoff.reset();
+            if (node->run()) { deques_[worker].push(*node); }
+        }
+
+        // parked peers must observe completion too
+        parker_.unpark_all();
+    }
+
+   public:
+    // the returned context is reserved for the caller, as other workers may be searching for contexts concurrently
+    [[nodiscard]] std::optional<coroutine_context> try_find_available_context() noexcept {
+        detail::context_node* node = pool_.reserve_idle();
+        if (node == nullptr) { return std::nullopt; }
+
+        return coroutine_context{node->stack().view_of(), node};
+    }
+
+    // terminates if every context is occupied
+    [[nodiscard]] coroutine_context find_available_context() noexcept { return try_find_available_context().value(); }
+
+    [[nodiscard]] std::size_t live_context_count() const noexcept { return pool_.live_count(); }
+    [[nodiscard]] constexpr std::size_t capacity() const noexcept { return context_stack_count; }
+    [[nodiscard]] bool execution_complete() const noexcept { return execution_complete_(); }
+
+    // the peak number of bytes occupied by the frames of the index-th context, for sizing B tightly
+    [[nodiscard]] std::size_t stack_high_water_mark(const std::size_t index) const noexcept {
+        return contexts_.stack(index).high_water_mark();
+    }
+
+    // the peak number of bytes occupied by the frames of any context
+    [[nodiscard]] std::size_t stack_high_water_mark() const noexcept {
+        std::size_t high_water_mark = 0;
+        for (std::size_t index = 0; index < context_stack_count; ++index) {
+            high_water_mark = std::max(high_water_mark, contexts_.stack(index).high_water_mark());
+        }
+
+        return high_water_mark;
+    }
+
+    // the number of frames which did not fit in their context's stack and were spilled to the heap
+    [[nodiscard]] std::size_t stack_overflow_count() const noexcept {
+        std::size_t overflow_count = 0;
+        for (std::size_t index = 0; index < context_stack_count; ++index) {
+            overflow_count += contexts_.stack(index).overflow_count();
+        }
+
+        return overflow_count;
+    }
+
+    // returns the memory of idle contexts' stacks to the OS (e.g. after a long idle period) for buffers supporting it,
+    // such as nano::mmap_buffer
+    void decommit_idle_stacks() noexcept {
+        if constexpr (requires(B& buffer) { buffer.decommit(); }) {
+            for (std::size_t index = 0; index < context_stack_count; ++index) {
+                pool_.if_idle(contexts_.node(index), [this, index] { contexts_.buffer(index).decommit(); });
+            }
+        }
+    }
+
+    // the calling thread serves as the first worker
+    void wait() {
+        std::array<std::jthread, worker_count - 1> helpers{};
+        for (std::size_t worker = 1; worker < worker_count; ++worker) {
+            helpers[worker - 1] = std::jthread([this, worker] { work_(worker); });
+        }
+
+        work_(0);
+    }
+
+    work_stealing_executor() noexcept {
+        for (std::size_t index = context_stack_count; index-- > 0;) {
+            detail::context_node& node = contexts_.node(index);
+            pool_.adopt(node);
+            node.queue_ = &injector_;
+            node.parker_ = &parker_;
+            node.wheel_ = &wheel_;
+            contexts_.stack(index).overflow_policy_ = detail::overflow_policy_v<O>;
+        }
+    }
+};
+
+}  // namespace nano
@@ -0,0 +1,131 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/timer.hpp>
+#include <nano/when.hpp>
+#include <nano/yield.hpp>
+
+#include <chrono>
+
+#include "test.hpp"
+
+namespace {
+
+using executor_type = nano::executor<nano::fixed_size_buffer<2048u>, 4u>;
+
+nano::continuation<int> spin(nano::coroutine_context) {
+    for (;;) { co_await nano::yield(); }
+}
+
+nano::continuation<int> nap(nano::coroutine_context) {
+    co_await nano::sleep_for(std::chrono::seconds(10));
+    co_return 0;
+}
+
+nano::continuation<int> all_of(nano::coroutine_context, executor_type& executor, const nano::cancellation_token token,
+                               bool& cancelled) {
+    auto first = spin(executor.find_available_context().with_cancellation(token));
+    auto second = spin(executor.find_available_context().with_cancellation(token));
+
+    try {
+        static_cast<void>(co_await nano::when_all(first, second));
+    } catch (const nano::operation_cancelled&) {
+        cancelled = true;
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int> any_of(nano::coroutine_context, executor_type& executor, const nano::cancellation_token token,
+                               bool& cancelled) {
+    auto first = spin(executor.find_available_context().with_cancellation(token));
+    auto second = spin(executor.find_available_context().with_cancellation(token));
+
+    try {
+        static_cast<void>(co_await nano::when_any(first, second));
+    } catch (const nano::operation_cancelled&) {
+        cancelled = true;
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int> timed(nano::coroutine_context, executor_type& executor, const nano::cancellation_token token,
+                              bool& cancelled) {
+    auto child = spin(executor.find_available_context().with_cancellation(token));
+
+    try {
+        static_cast<void>(co_await nano::timeout(child, std::chrono::seconds(10)));
+    } catch (const nano::operation_cancelled&) {
+        cancelled = true;
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int> sleeper(nano::coroutine_context, executor_type& executor, const nano::cancellation_token token,
+                                bool& cancelled) {
+    try {
+        static_cast<void>(co_await nap(executor.find_available_context().with_cancellation(token)));
+    } catch (const nano::operation_cancelled&) {
+        cancelled = true;
+    }
+
+    co_return 0;
+}
+
+// the children always carry the token, and the parent only when shared. Either way, the parent's await throws, well
+// before any 10 second timeout or sleep would have elapsed
+template <typename F>
+void check_cancelled(F&& parent, const bool shared) {
+    executor_type executor{};
+    nano::cancellation_source source{};
+    bool cancelled = false;
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        nano::coroutine_context context = executor.find_available_context();
+        if (shared) { context = context.with_cancellation(source.token()); }
+
+        [[maybe_unused]] auto pending = parent(context, executor, source.token(), cancelled);
+        for (int step = 0; step < 3; ++step) { executor.step(); }
+
+        source.request_cancellation();
+        executor.wait();
+    }
+
+    NANO_CHECK(cancelled);
+    NANO_CHECK(executor.live_context_count() == 0);
+    NANO_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+}
+
+}  // namespace
+
+int main() {
+    for (const bool shared : {true, false}) {
+        check_cancelled(all_of, shared);
+        check_cancelled(any_of, shared);
+        check_cancelled(timed, shared);
+        check_cancelled(sleeper, shared);
+    }
+
+    return test::result();
+}
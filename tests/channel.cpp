@@ -0,0 +1,158 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/channel.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+using executor_type = nano::executor<nano::fixed_size_buffer<1024u>, 4u>;
+
+nano::continuation<int> produce(nano::coroutine_context, nano::channel<int, 2u>& channel, const int count, int& sent) {
+    for (int value = 0; value < count; ++value) {
+        if (!co_await channel.send(value)) { break; }
+        ++sent;
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int> consume(nano::coroutine_context, nano::channel<int, 2u>& channel, std::vector<int>& received) {
+    while (const std::optional<int> value = co_await channel.receive()) { received.push_back(*value); }
+    co_return 0;
+}
+
+// the sender suspends once the channel is full, until a receiver makes room
+void check_full() {
+    executor_type executor{};
+    nano::channel<int, 2u> channel{};
+    std::vector<int> received{};
+    int sent = 0;
+
+    {
+        [[maybe_unused]] auto producer = produce(executor.find_available_context(), channel, 8, sent);
+        for (int step = 0; step < 4; ++step) { executor.step(); }
+
+        NANO_CHECK(sent == 2);
+        NANO_CHECK(channel.size() == 2u);
+
+        [[maybe_unused]] auto consumer = consume(executor.find_available_context(), channel, received);
+        while (sent < 8) { executor.step(); }
+
+        channel.close();
+        executor.wait();
+    }
+
+    NANO_CHECK((received == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+// the receiver suspends while the channel is empty, and is handed the next value sent
+void check_empty() {
+    executor_type executor{};
+    nano::channel<int, 2u> channel{};
+    std::vector<int> received{};
+
+    {
+        [[maybe_unused]] auto consumer = consume(executor.find_available_context(), channel, received);
+        for (int step = 0; step < 4; ++step) { executor.step(); }
+        NANO_CHECK(received.empty());
+
+        NANO_CHECK(channel.try_send(1));
+        NANO_CHECK(channel.size() == 0u);
+        executor.step();
+        NANO_CHECK((received == std::vector<int>{1}));
+
+        channel.close();
+        executor.wait();
+    }
+}
+
+// closing fails a waiting sender, while the values already buffered are still received ahead of std::nullopt
+void check_close() {
+    executor_type executor{};
+    nano::channel<int, 2u> channel{};
+    std::vector<int> received{};
+    int sent = 0;
+
+    {
+        [[maybe_unused]] auto producer = produce(executor.find_available_context(), channel, 8, sent);
+        executor.step();
+        NANO_CHECK(sent == 2);
+
+        channel.close();
+        executor.step();
+        NANO_CHECK(!channel.try_send(9));
+
+        [[maybe_unused]] auto consumer = consume(executor.find_available_context(), channel, received);
+        executor.wait();
+    }
+
+    NANO_CHECK(sent == 2);
+    NANO_CHECK((received == std::vector<int>{0, 1}));
+    NANO_CHECK(!channel.try_receive().has_value());
+}
+
+nano::continuation<int> consume_many(nano::coroutine_context, nano::channel<int, 4u>& channel,
+                                     std::vector<std::size_t>& batches) {
+    std::array<int, 8u> items{};
+    while (const std::size_t count = co_await channel.receive_many(std::span(items))) { batches.push_back(count); }
+    co_return 0;
+}
+
+// a receiver waiting for many values is handed each value sent until its items are full or it resumes, after which
+// values are buffered until the channel is full
+void check_receive_many() {
+    executor_type executor{};
+    nano::channel<int, 4u> channel{};
+    std::vector<std::size_t> batches{};
+
+    {
+        [[maybe_unused]] auto consumer = consume_many(executor.find_available_context(), channel, batches);
+        for (int value = 0; value < 3; ++value) { NANO_CHECK(channel.try_send(value)); }
+        NANO_CHECK(channel.size() == 0u);
+        executor.step();
+
+        for (int value = 0; value < 12; ++value) { NANO_CHECK(channel.try_send(value)); }
+        NANO_CHECK(channel.size() == 4u);
+        NANO_CHECK(!channel.try_send(12));
+        executor.step();
+
+        channel.close();
+        executor.wait();
+    }
+
+    NANO_CHECK((batches == std::vector<std::size_t>{3u, 8u, 4u}));
+}
+
+}  // namespace
+
+int main() {
+    check_full();
+    check_empty();
+    check_close();
+    check_receive_many();
+    return test::result();
+}
@@ -0,0 +1,90 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/executor_group.hpp>
+#include <nano/timer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "test.hpp"
+
+namespace {
+
+// a single context per shard, so that a coroutine posted once the caller finishes reuses the caller's stack
+using group_type = nano::executor_group<nano::executor<nano::fixed_size_buffer<4096u>, 1u>, 2u>;
+
+enum class outcome { pending, returned, cancelled };
+
+constexpr unsigned char pattern = 0xab;
+
+nano::continuation<int> slow(nano::coroutine_context) {
+    co_await nano::sleep_for(std::chrono::milliseconds(200));
+    co_return 1;
+}
+
+// fills its frame, which overlays the caller's, and checks it once the remote shard would have replied
+nano::continuation<int> victim(nano::coroutine_context, std::atomic_bool& intact) {
+    std::array<unsigned char, 1024> bytes{};
+    bytes.fill(pattern);
+
+    co_await nano::sleep_for(std::chrono::milliseconds(400));
+    intact = std::all_of(bytes.begin(), bytes.end(), [](const unsigned char byte) { return byte == pattern; });
+    co_return 0;
+}
+
+nano::continuation<int> caller(nano::coroutine_context context, group_type& group, const nano::cancellation_token token,
+                               std::atomic<outcome>& result, std::atomic_bool& intact) {
+    try {
+        static_cast<void>(co_await nano::call(context.with_cancellation(token), group, 1u, slow));
+        result = outcome::returned;
+    } catch (const nano::operation_cancelled&) {
+        result = outcome::cancelled;
+    }
+
+    // runs once this coroutine is reclaimed, as its shard has no other context
+    group.post(0u, victim, std::ref(intact));
+    co_return 0;
+}
+
+}  // namespace
+
+int main() {
+    nano::cancellation_source source{};
+    std::atomic<outcome> result{outcome::pending};
+    std::atomic_bool intact{false};
+
+    {
+        group_type group{};
+        group.post(0u, caller, std::ref(group), source.token(), std::ref(result), std::ref(intact));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        source.request_cancellation();
+    }
+
+    NANO_CHECK(result == outcome::cancelled);
+    NANO_CHECK(intact);
+    return test::result();
+}
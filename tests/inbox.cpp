@@ -0,0 +1,135 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/inbox.hpp>
+
+#include <array>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+constexpr int producer_count = 4;
+constexpr int messages_per_producer = 10000;
+
+using executor_type = nano::executor<nano::fixed_size_buffer<2048u>, 1u>;
+using inbox_type = nano::inbox<int, 64u>;
+
+struct tally {
+    int received{0};
+    bool ordered{true};
+    std::array<int, producer_count> last{-1, -1, -1, -1};
+};
+
+// messages from each producer arrive in the order it sent them, however they interleave with other producers'
+nano::continuation<int> drain(nano::coroutine_context, inbox_type& inbox, tally& counts) {
+    while (const std::optional<int> message = co_await inbox) {
+        const int producer = *message / messages_per_producer;
+        const int sequence = *message % messages_per_producer;
+
+        counts.ordered = counts.ordered && sequence == counts.last[producer] + 1;
+        counts.last[producer] = sequence;
+        ++counts.received;
+    }
+
+    co_return 0;
+}
+
+// the receiver suspends whenever the inbox runs dry, so is woken by producers on other threads throughout
+void check_producers() {
+    executor_type executor{};
+    inbox_type inbox{};
+    tally counts{};
+
+    {
+        [[maybe_unused]] auto receiver = drain(executor.find_available_context(), inbox, counts);
+
+        std::jthread closer([&inbox] {
+            std::vector<std::jthread> producers{};
+            for (int producer = 0; producer < producer_count; ++producer) {
+                producers.emplace_back([&inbox, producer] {
+                    for (int sequence = 0; sequence < messages_per_producer; ++sequence) {
+                        const int message = producer * messages_per_producer + sequence;
+                        while (!inbox.try_send(message)) { std::this_thread::yield(); }
+                    }
+                });
+            }
+
+            producers.clear();
+            inbox.close();
+        });
+
+        executor.wait();
+    }
+
+    NANO_CHECK(counts.received == producer_count * messages_per_producer);
+    NANO_CHECK(counts.ordered);
+    for (const int last : counts.last) { NANO_CHECK(last == messages_per_producer - 1); }
+}
+
+// a batch is sent whole or not at all, and is received in order
+void check_batches() {
+    nano::inbox<int, 4u> inbox{};
+    const std::array<int, 5u> values{1, 2, 3, 4, 5};
+
+    NANO_CHECK(!inbox.try_send(values.begin(), values.end()));
+    NANO_CHECK(inbox.try_send(values.begin(), values.begin() + 3));
+    NANO_CHECK(!inbox.try_send(values.begin() + 3, values.end()));
+    NANO_CHECK(inbox.try_send(values[3]));
+    NANO_CHECK(!inbox.try_send(values[4]));
+
+    for (int expected = 1; expected <= 4; ++expected) { NANO_CHECK(inbox.try_receive() == expected); }
+    NANO_CHECK(!inbox.try_receive().has_value());
+}
+
+nano::continuation<int> receive_all(nano::coroutine_context, nano::inbox<int, 4u>& inbox, std::vector<int>& received) {
+    while (const std::optional<int> message = co_await inbox) { received.push_back(*message); }
+    co_return 0;
+}
+
+// closing an inbox still holding messages lets the receiver drain them before observing std::nullopt
+void check_close() {
+    executor_type executor{};
+    nano::inbox<int, 4u> inbox{};
+    std::vector<int> received{};
+
+    NANO_CHECK(inbox.try_send(1));
+    NANO_CHECK(inbox.try_send(2));
+    inbox.close();
+
+    {
+        [[maybe_unused]] auto receiver = receive_all(executor.find_available_context(), inbox, received);
+        executor.wait();
+    }
+
+    NANO_CHECK((received == std::vector<int>{1, 2}));
+}
+
+}  // namespace
+
+int main() {
+    check_producers();
+    check_batches();
+    check_close();
+    return test::result();
+}
@@ -0,0 +1,202 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/io.hpp>
+#include <nano/yield.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include "test.hpp"
+
+namespace {
+
+using executor_type = nano::executor<nano::fixed_size_buffer<4096u>, 4u>;
+
+// exit status reported to CTest when io_uring is unavailable (see tests/CMakeLists.txt)
+constexpr int skipped = 77;
+
+constexpr std::string_view message = "Hello io_uring";
+
+[[nodiscard]] std::string_view view_of(const std::array<char, 64u>& buffer, const int count) {
+    return count < 0 ? std::string_view{} : std::string_view(buffer.data(), static_cast<std::size_t>(count));
+}
+
+nano::continuation<int> write_then_read(nano::coroutine_context, nano::io::ring& ring, const int fd,
+                                        std::string_view& read_back) {
+    const int written = co_await nano::io::write(ring, fd, std::as_bytes(std::span(message)), 0u);
+    NANO_CHECK(written == static_cast<int>(message.size()));
+
+    std::array<char, 64u> buffer{};
+    const int count = co_await nano::io::read(ring, fd, std::as_writable_bytes(std::span(buffer)), 0u);
+    NANO_CHECK(count == static_cast<int>(message.size()));
+
+    read_back = view_of(buffer, count) == message ? message : std::string_view{};
+    co_return 0;
+}
+
+// echoes a single message back on the first connection accepted
+nano::continuation<int> echo_server(nano::coroutine_context, nano::io::ring& ring, const int listener) {
+    const int fd = co_await nano::io::accept(ring, listener);
+    NANO_CHECK(fd >= 0);
+
+    std::array<char, 64u> buffer{};
+    const int count = co_await nano::io::recv(ring, fd, std::as_writable_bytes(std::span(buffer)));
+    NANO_CHECK(count > 0);
+
+    const int sent = co_await nano::io::send(ring, fd, std::as_bytes(std::span(buffer).first(count)));
+    NANO_CHECK(sent == count);
+
+    close(fd);
+    co_return 0;
+}
+
+nano::continuation<int> echo_client(nano::coroutine_context, nano::io::ring& ring, const sockaddr_in address,
+                                    std::string_view& echoed) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    NANO_CHECK(co_await nano::io::connect(ring, fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) ==
+               0);
+
+    const int sent = co_await nano::io::send(ring, fd, std::as_bytes(std::span(message)));
+    NANO_CHECK(sent == static_cast<int>(message.size()));
+
+    std::array<char, 64u> buffer{};
+    const int count = co_await nano::io::recv(ring, fd, std::as_writable_bytes(std::span(buffer)));
+    echoed = view_of(buffer, count) == message ? message : std::string_view{};
+
+    close(fd);
+    co_return 0;
+}
+
+// the peer never sends, so the receive only completes once cancelled
+nano::continuation<int> idle_recv(nano::coroutine_context, nano::io::ring& ring, const int fd, bool& cancelled) {
+    std::array<char, 64u> buffer{};
+
+    try {
+        static_cast<void>(co_await nano::io::recv(ring, fd, std::as_writable_bytes(std::span(buffer))));
+    } catch (const nano::operation_cancelled&) {
+        cancelled = true;
+    }
+
+    co_return 0;
+}
+
+nano::continuation<int> cancel_after(nano::coroutine_context, nano::cancellation_source& source, const int steps) {
+    for (int step = 0; step < steps; ++step) { co_await nano::yield(); }
+    source.request_cancellation();
+    co_return 0;
+}
+
+void check_file(executor_type& executor, nano::io::ring& ring) {
+    std::FILE* file = std::tmpfile();
+    NANO_CHECK(file != nullptr);
+    if (file == nullptr) { return; }
+
+    std::string_view read_back{};
+    {
+        [[maybe_unused]] auto pending =
+            write_then_read(executor.find_available_context(), ring, fileno(file), read_back);
+        executor.wait();
+    }
+
+    NANO_CHECK(read_back == message);
+    std::fclose(file);
+}
+
+void check_socket(executor_type& executor, nano::io::ring& ring) {
+    const int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t length = sizeof(address);
+    NANO_CHECK(bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    NANO_CHECK(listen(listener, 1) == 0);
+    NANO_CHECK(getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+
+    std::string_view echoed{};
+    {
+        [[maybe_unused]] auto server = echo_server(executor.find_available_context(), ring, listener);
+        [[maybe_unused]] auto client = echo_client(executor.find_available_context(), ring, address, echoed);
+        executor.wait();
+    }
+
+    NANO_CHECK(echoed == message);
+    close(listener);
+}
+
+// well before the peer (which never sends) could have completed it, the receive is cancelled in flight
+void check_cancelled(executor_type& executor, nano::io::ring& ring, const int steps) {
+    std::array<int, 2u> fds{};
+    NANO_CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds.data()) == 0);
+
+    nano::cancellation_source source{};
+    bool cancelled = false;
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        const auto context = executor.find_available_context().with_cancellation(source.token());
+        [[maybe_unused]] auto pending = idle_recv(context, ring, fds[0], cancelled);
+        [[maybe_unused]] auto timer = cancel_after(executor.find_available_context(), source, steps);
+        executor.wait();
+    }
+
+    NANO_CHECK(cancelled);
+    NANO_CHECK(executor.live_context_count() == 0);
+    NANO_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+}  // namespace
+
+int main() {
+    std::optional<nano::io::ring> ring{};
+    try {
+        ring.emplace();
+    } catch (const std::system_error& error) {
+        std::fprintf(stderr, "io_uring unavailable (%s), skipping\n", error.what());
+        return skipped;
+    }
+
+    executor_type executor{};
+    executor.attach(*ring);
+
+    check_file(executor, *ring);
+    check_socket(executor, *ring);
+
+    // cancelled both steps after the receive was submitted, and within the step it is made
+    check_cancelled(executor, *ring, 3);
+    check_cancelled(executor, *ring, 0);
+
+    return test::result();
+}
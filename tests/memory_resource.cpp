@@ -0,0 +1,109 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/memory_resource.hpp>
+#include <nano/task.hpp>
+#include <nano/yield.hpp>
+
+#include <array>
+#include <memory_resource>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+using executor_type = nano::executor<nano::fixed_size_buffer<8192u>, 1u>;
+
+nano::task<int> child(nano::coroutine_context, const int value) { co_return value; }
+
+// a frame larger than child's, so that it would cover memory bumped past a destroyed child
+nano::continuation<int> wide(nano::coroutine_context) {
+    std::array<long, 128> filler{};
+    filler.fill(-1);
+    co_await nano::yield();
+    co_return static_cast<int>(filler.back() + 2);
+}
+
+// the finished task's frame sits above the parent's until destroyed, so the scratch memory must not be bumped past it:
+// it would be reclaimed along with the task, and overwritten by the next frame spawned
+nano::continuation<int> scratch_above_task(nano::coroutine_context context, int& result, bool& done, bool& intact) {
+    auto memory = context.memory_resource();
+    std::pmr::vector<long> values(&memory);
+
+    {
+        auto pending = child(context, 42);
+        values.assign(64, 7);
+
+        done = pending.done();
+        result = co_await pending;
+    }
+
+    result += co_await wide(context);
+    intact = values == std::pmr::vector<long>(64, 7);
+    co_return 0;
+}
+
+// with nothing above its frame, scratch memory comes off the stack and is reclaimed along with the frame
+nano::continuation<int> scratch_on_stack(nano::coroutine_context context, std::size_t& used) {
+    auto memory = context.memory_resource();
+    std::pmr::vector<long> values(&memory);
+    values.assign(64, 7);
+
+    used = values.size();
+    co_return 0;
+}
+
+}  // namespace
+
+int main() {
+    {
+        executor_type executor{};
+        int result = 0;
+        bool done = false;
+        bool intact = false;
+
+        {
+            [[maybe_unused]] auto pending = scratch_above_task(executor.find_available_context(), result, done, intact);
+            executor.wait();
+        }
+
+        NANO_CHECK(done);
+        NANO_CHECK(result == 43);
+        NANO_CHECK(intact);
+        NANO_CHECK(executor.live_context_count() == 0);
+    }
+
+    {
+        executor_type executor{};
+        std::size_t used = 0;
+
+        {
+            [[maybe_unused]] auto pending = scratch_on_stack(executor.find_available_context(), used);
+            executor.wait();
+        }
+
+        NANO_CHECK(used == 64);
+        NANO_CHECK(executor.stack_high_water_mark(0) >= 64 * sizeof(long));
+        NANO_CHECK(executor.try_find_available_context().has_value());
+    }
+
+    return test::result();
+}
@@ -0,0 +1,192 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/mutex.hpp>
+#include <nano/work_stealing_executor.hpp>
+#include <nano/yield.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+template <typename C>
+struct holder {
+    C continuation;
+
+    template <typename F>
+    explicit holder(F&& spawn) : continuation{spawn()} {}
+};
+
+using pending_list = std::vector<std::unique_ptr<holder<nano::continuation<int>>>>;
+
+struct occupancy {
+    std::atomic_int inside{0};
+    std::atomic_int peak{0};
+
+    void enter() noexcept {
+        const int now = inside.fetch_add(1) + 1;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+    }
+
+    void leave() noexcept { inside.fetch_sub(1); }
+};
+
+// holds the lock across yields, so that every contender queues behind it
+template <typename T>
+nano::continuation<int> hold(nano::coroutine_context context, T& primitive, std::vector<int>& order, const int id) {
+    const auto guard = co_await nano::lock(context, primitive);
+    order.push_back(id);
+    for (int step = 0; step < 3; ++step) { co_await nano::yield(); }
+    co_return 0;
+}
+
+// contenders acquire the mutex in the order they began waiting, each release handing it to the next
+void check_fifo_handoff() {
+    nano::executor<nano::fixed_size_buffer<1024u>, 8u> executor{};
+    nano::mutex mutex{};
+    std::vector<int> order{};
+
+    {
+        pending_list pending{};
+        for (int id = 0; id < 8; ++id) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return hold(executor.find_available_context(), mutex, order, id); }));
+        }
+
+        executor.wait();
+    }
+
+    NANO_CHECK((order == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+template <typename T>
+nano::continuation<int> increment(nano::coroutine_context context, T& primitive, occupancy& counts, long& counter,
+                                  const int rounds) {
+    for (int round = 0; round < rounds; ++round) {
+        const auto guard = co_await nano::lock(context, primitive);
+        counts.enter();
+
+        // a plain read-modify-write held open for a while (a yield alone resumes the same context at once), which only
+        // adds up while the lock excludes every other worker
+        const long value = counter;
+        for (int spin = 0; spin < 16; ++spin) { std::this_thread::yield(); }
+        co_await nano::yield();
+        counter = value + 1;
+
+        counts.leave();
+    }
+
+    co_return 0;
+}
+
+// ownership handed over between coroutines running on different workers
+void check_contention() {
+    constexpr std::size_t context_count = 16u;
+    constexpr int rounds = 500;
+
+    auto executor = std::make_unique<nano::work_stealing_executor<nano::fixed_size_buffer<1024u>, context_count, 4u>>();
+    nano::mutex mutex{};
+    occupancy counts{};
+    long counter = 0;
+
+    {
+        pending_list pending{};
+        for (std::size_t index = 0; index < context_count; ++index) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return increment(executor->find_available_context(), mutex, counts, counter, rounds); }));
+        }
+
+        executor->wait();
+    }
+
+    NANO_CHECK(counter == static_cast<long>(context_count) * rounds);
+    NANO_CHECK(counts.peak.load() == 1);
+}
+
+template <typename T>
+nano::continuation<int> occupy(nano::coroutine_context context, T& semaphore, occupancy& counts) {
+    const auto guard = co_await nano::acquire(context, semaphore);
+    counts.enter();
+    for (int step = 0; step < 3; ++step) { co_await nano::yield(); }
+    counts.leave();
+    co_return 0;
+}
+
+// no more coroutines hold a unit at once than the semaphore has, and every contender is eventually handed one
+void check_semaphore() {
+    nano::executor<nano::fixed_size_buffer<1024u>, 8u> executor{};
+    nano::semaphore semaphore{2u};
+    occupancy counts{};
+
+    {
+        pending_list pending{};
+        for (int id = 0; id < 8; ++id) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return occupy(executor.find_available_context(), semaphore, counts); }));
+        }
+
+        executor.wait();
+    }
+
+    NANO_CHECK(counts.peak.load() == 2);
+    NANO_CHECK(executor.live_context_count() == 0);
+}
+
+nano::continuation<int> read(nano::coroutine_context context, nano::shared_mutex& mutex, std::vector<int>& order,
+                             const int id) {
+    const auto guard = co_await nano::lock_shared(context, mutex);
+    order.push_back(id);
+    for (int step = 0; step < 3; ++step) { co_await nano::yield(); }
+    co_return 0;
+}
+
+// readers share the mutex, but a reader arriving after a queued writer waits behind it
+void check_shared_mutex() {
+    nano::executor<nano::fixed_size_buffer<1024u>, 4u> executor{};
+    nano::shared_mutex mutex{};
+    std::vector<int> order{};
+
+    {
+        [[maybe_unused]] auto first = read(executor.find_available_context(), mutex, order, 0);
+        [[maybe_unused]] auto second = read(executor.find_available_context(), mutex, order, 1);
+        [[maybe_unused]] auto writer = hold(executor.find_available_context(), mutex, order, 2);
+        [[maybe_unused]] auto third = read(executor.find_available_context(), mutex, order, 3);
+        executor.wait();
+    }
+
+    NANO_CHECK((order == std::vector<int>{0, 1, 2, 3}));
+}
+
+}  // namespace
+
+int main() {
+    check_fifo_handoff();
+    check_contention();
+    check_semaphore();
+    check_shared_mutex();
+    return test::result();
+}
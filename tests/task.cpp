@@ -0,0 +1,120 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/task.hpp>
+#include <nano/when.hpp>
+
+#include "test.hpp"
+
+namespace {
+
+using executor_type = nano::executor<nano::fixed_size_buffer<4096u>, 1u>;
+
+nano::task<int> child(nano::coroutine_context, const int value) { co_return value; }
+
+// both tasks finish (and are popped) before either is awaited, so the second is spawned above the first's live frame
+nano::continuation<int> held(nano::coroutine_context context, int& first, int& second) {
+    auto a = child(context, 1);
+    auto b = child(context, 2);
+
+    first = co_await a;
+    second = co_await b;
+    co_return 0;
+}
+
+// as above, awaited in the opposite order and destroyed out of order, after which the stack is reused
+nano::continuation<int> reordered(nano::coroutine_context context, int& first, int& second, int& third) {
+    {
+        auto a = child(context, 1);
+        {
+            auto b = child(context, 2);
+            second = co_await b;
+        }
+
+        auto c = child(context, 3);
+        first = co_await a;
+        third = co_await c;
+    }
+
+    auto d = child(context, 4);
+    third += co_await d;
+    co_return 0;
+}
+
+nano::continuation<int> joined(nano::coroutine_context context, int& sum) {
+    auto a = child(context, 1);
+    auto b = child(context, 2);
+
+    const auto [first, second] = co_await nano::when_all(a, b);
+    sum = first + second;
+    co_return 0;
+}
+
+}  // namespace
+
+int main() {
+    NANO_CHECK(nano::task<int>{}.done());
+
+    {
+        executor_type executor{};
+        int first = 0;
+        int second = 0;
+
+        {
+            [[maybe_unused]] auto pending = held(executor.find_available_context(), first, second);
+            executor.wait();
+        }
+
+        NANO_CHECK(first == 1);
+        NANO_CHECK(second == 2);
+        NANO_CHECK(executor.live_context_count() == 0);
+    }
+
+    {
+        executor_type executor{};
+        int first = 0;
+        int second = 0;
+        int third = 0;
+
+        {
+            [[maybe_unused]] auto pending = reordered(executor.find_available_context(), first, second, third);
+            executor.wait();
+        }
+
+        NANO_CHECK(first == 1);
+        NANO_CHECK(second == 2);
+        NANO_CHECK(third == 7);
+        NANO_CHECK(executor.try_find_available_context().has_value());
+    }
+
+    {
+        executor_type executor{};
+        int sum = 0;
+
+        {
+            [[maybe_unused]] auto pending = joined(executor.find_available_context(), sum);
+            executor.wait();
+        }
+
+        NANO_CHECK(sum == 3);
+    }
+
+    return test::result();
+}
@@ -0,0 +1,38 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdio>
+
+namespace test {
+
+inline int failures = 0;
+
+// records a failed expectation, reporting where it was made
+inline void check(const bool condition, const char* expression, const char* file, const int line) {
+    if (condition) { return; }
+
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++failures;
+}
+
+[[nodiscard]] inline int result() { return failures == 0 ? 0 : 1; }
+
+}  // namespace test
+
+#define NANO_CHECK(...) ::test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
@@ -0,0 +1,128 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/continuation.hpp>
+#include <nano/executor.hpp>
+#include <nano/timer.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+struct timer {
+    std::chrono::milliseconds delay;
+    std::atomic_bool delivered{false};
+    nano::detail::timer_node node{};
+};
+
+// one timer per level, at and either side of each level's boundary, and beyond the wheel's horizon (~4.7 hours) in
+// the overflow list. Each is only reached by cascading down through every level above its own
+constexpr std::array<std::chrono::milliseconds, 14u> delays{
+    1ms, 5ms, 63ms, 64ms, 65ms, 4095ms, 4096ms, 4097ms, 70000ms, 262143ms, 262144ms, 1000000ms, 16777216ms, 20000000ms,
+};
+
+// the wheel is driven by hand, advancing to just before and then to each deadline in turn
+void check_wheel_ordering() {
+    nano::detail::timer_wheel wheel{};
+    const auto base = nano::detail::clock::now();
+
+    std::array<timer, delays.size()> timers{};
+    for (std::size_t index = delays.size(); index-- > 0;) {
+        timer& entry = timers[index];
+        entry.delay = delays[index];
+        entry.node.delivered_ = &entry.delivered;
+        NANO_CHECK(wheel.insert(entry.node, base + entry.delay));
+    }
+
+    for (std::size_t index = 0; index < timers.size(); ++index) {
+        // deadlines round up to the next tick, so that a timer expires by the tick after its delay
+        wheel.advance(base + timers[index].delay - 1ms);
+        NANO_CHECK(!timers[index].delivered.load());
+
+        wheel.advance(base + timers[index].delay + 1ms);
+        for (std::size_t other = 0; other < timers.size(); ++other) {
+            NANO_CHECK(timers[other].delivered.load() == (other <= index));
+        }
+    }
+
+    NANO_CHECK(!wheel.next_expiry().has_value());
+}
+
+// a cancelled timer is never delivered, even once cascaded down from a higher level
+void check_wheel_cancel() {
+    nano::detail::timer_wheel wheel{};
+    const auto base = nano::detail::clock::now();
+
+    timer kept{};
+    timer cancelled{};
+    timer passed{};
+    kept.node.delivered_ = &kept.delivered;
+    cancelled.node.delivered_ = &cancelled.delivered;
+
+    NANO_CHECK(wheel.insert(cancelled.node, base + 5000ms));
+    NANO_CHECK(wheel.insert(kept.node, base + 6000ms));
+    NANO_CHECK(!wheel.insert(passed.node, base - 1ms));
+
+    wheel.advance(base + 4096ms);
+    wheel.cancel(cancelled.node);
+    NANO_CHECK(wheel.next_expiry().has_value());
+
+    wheel.advance(base + 7000ms);
+    NANO_CHECK(!cancelled.delivered.load());
+    NANO_CHECK(kept.delivered.load());
+    NANO_CHECK(!wheel.next_expiry().has_value());
+}
+
+nano::continuation<int> nap(nano::coroutine_context, const std::chrono::milliseconds delay, std::vector<int>& order,
+                            const int id) {
+    co_await nano::sleep_for(delay);
+    order.push_back(id);
+    co_return 0;
+}
+
+// coroutines sleeping on an executor wake in deadline order, whatever order they went to sleep in
+void check_sleep_ordering() {
+    nano::executor<nano::fixed_size_buffer<1024u>, 3u> executor{};
+    std::vector<int> order{};
+
+    {
+        [[maybe_unused]] auto third = nap(executor.find_available_context(), 60ms, order, 3);
+        [[maybe_unused]] auto first = nap(executor.find_available_context(), 20ms, order, 1);
+        [[maybe_unused]] auto second = nap(executor.find_available_context(), 40ms, order, 2);
+        executor.wait();
+    }
+
+    NANO_CHECK((order == std::vector<int>{1, 2, 3}));
+}
+
+}  // namespace
+
+int main() {
+    check_wheel_ordering();
+    check_wheel_cancel();
+    check_sleep_ordering();
+    return test::result();
+}
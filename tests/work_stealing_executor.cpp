@@ -0,0 +1,204 @@
+/*
+  nano-coro is a minimal coroutine library by Connor McMonigle
+  Copyright (C) 2024  Connor McMonigle
+
+  nano-coro is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  nano-coro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nano/buffer.hpp>
+#include <nano/cancellation.hpp>
+#include <nano/continuation.hpp>
+#include <nano/event.hpp>
+#include <nano/timer.hpp>
+#include <nano/work_stealing_executor.hpp>
+#include <nano/yield.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+namespace {
+
+constexpr std::size_t worker_count = 4u;
+constexpr std::size_t context_count = 16u;
+
+using executor_type = nano::work_stealing_executor<nano::fixed_size_buffer<2048u>, context_count, worker_count>;
+
+template <typename C>
+struct holder {
+    C continuation;
+
+    template <typename F>
+    explicit holder(F&& spawn) : continuation{spawn()} {}
+};
+
+struct occupancy {
+    std::atomic_size_t running{0};
+    std::atomic_size_t peak{0};
+    std::atomic_size_t completed{0};
+};
+
+// spins without yielding until a peer runs alongside it (or a deadline passes), which only happens once idle workers
+// steal the contexts queued behind it
+nano::continuation<int> spin_alongside(nano::coroutine_context, occupancy& counts) {
+    const std::size_t running = counts.running.fetch_add(1) + 1;
+    std::size_t peak = counts.peak.load();
+    while (running > peak && !counts.peak.compare_exchange_weak(peak, running)) {}
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (counts.peak.load() < 2u && std::chrono::steady_clock::now() < deadline) {}
+
+    counts.running.fetch_sub(1);
+    counts.completed.fetch_add(1);
+    co_return 0;
+}
+
+// each yield may resume on a different worker, so the sum is only right if the frames migrate intact
+nano::continuation<int> migrate(nano::coroutine_context, const int steps, std::atomic_long& total) {
+    std::array<long, 16u> partial{};
+    for (int step = 0; step < steps; ++step) {
+        partial[static_cast<std::size_t>(step) % partial.size()] += step;
+        co_await nano::yield();
+    }
+
+    long sum = 0;
+    for (const long value : partial) { sum += value; }
+    total.fetch_add(sum);
+    co_return 0;
+}
+
+nano::continuation<int> receive(nano::coroutine_context, nano::event<int>& event, std::atomic_int& total) {
+    total.fetch_add(co_await event);
+    co_return 0;
+}
+
+// the timer and the cancellation race to resume the frame: a frame resumed by its timer blocks withdrawing from the
+// cancellation while the request signals its peers, and is then signalled again as it completes
+nano::continuation<int> nap(nano::coroutine_context) {
+    try {
+        co_await nano::sleep_for(std::chrono::milliseconds(2));
+    } catch (const nano::operation_cancelled&) {}
+
+    co_return 0;
+}
+
+void check_steal() {
+    auto executor = std::make_unique<executor_type>();
+    occupancy counts{};
+
+    {
+        std::vector<std::unique_ptr<holder<nano::continuation<int>>>> pending{};
+        for (std::size_t index = 0; index < context_count; ++index) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return spin_alongside(executor->find_available_context(), counts); }));
+        }
+
+        executor->wait();
+    }
+
+    NANO_CHECK(counts.completed.load() == context_count);
+    NANO_CHECK(counts.peak.load() >= 2u);
+    NANO_CHECK(executor->live_context_count() == 0);
+}
+
+void check_migrate() {
+    constexpr int steps = 1000;
+    auto executor = std::make_unique<executor_type>();
+    std::atomic_long total{0};
+
+    {
+        std::vector<std::unique_ptr<holder<nano::continuation<int>>>> pending{};
+        for (std::size_t index = 0; index < context_count; ++index) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return migrate(executor->find_available_context(), steps, total); }));
+        }
+
+        executor->wait();
+    }
+
+    NANO_CHECK(total.load() == static_cast<long>(context_count) * steps * (steps - 1) / 2);
+    NANO_CHECK(executor->live_context_count() == 0);
+}
+
+// the workers idle until every event is sent from another thread, each send waking one
+void check_wake() {
+    auto executor = std::make_unique<executor_type>();
+    std::array<nano::event<int>, context_count> events{};
+    std::atomic_int total{0};
+
+    {
+        std::vector<std::unique_ptr<holder<nano::continuation<int>>>> pending{};
+        for (auto& event : events) {
+            pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                [&] { return receive(executor->find_available_context(), event, total); }));
+        }
+
+        std::jthread sender([&events] {
+            for (auto& event : events) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                event.send(1);
+            }
+        });
+
+        executor->wait();
+    }
+
+    NANO_CHECK(total.load() == static_cast<int>(context_count));
+    NANO_CHECK(executor->live_context_count() == 0);
+}
+
+// a context queued as its last frame completes is still run by wait(), releasing it to be handed out again
+void check_queued_at_completion() {
+    auto executor = std::make_unique<executor_type>();
+
+    for (int round = 0; round < 100; ++round) {
+        nano::cancellation_source source{};
+
+        {
+            std::vector<std::unique_ptr<holder<nano::continuation<int>>>> pending{};
+            for (std::size_t index = 0; index < context_count; ++index) {
+                const auto context = executor->try_find_available_context();
+                NANO_CHECK(context.has_value());
+                if (!context.has_value()) { return; }
+
+                pending.push_back(std::make_unique<holder<nano::continuation<int>>>(
+                    [&] { return nap(context->with_cancellation(source.token())); }));
+            }
+
+            std::jthread canceller([&source, round] {
+                std::this_thread::sleep_for(std::chrono::microseconds(1500 + 10 * round));
+                source.request_cancellation();
+            });
+
+            executor->wait();
+        }
+
+        NANO_CHECK(executor->live_context_count() == 0);
+    }
+}
+
+}  // namespace
+
+int main() {
+    check_steal();
+    check_migrate();
+    check_wake();
+    check_queued_at_completion();
+    return test::result();
+}